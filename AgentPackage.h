@@ -44,14 +44,25 @@
 #ifndef AGENTPACKAGE_H
 #define AGENTPACKAGE_H
 
+#include <type_traits>
 #include <vector>
+#include <boost/mpi/datatype.hpp>
+#include <boost/serialization/is_bitwise_serializable.hpp>
+#include <boost/serialization/level.hpp>
+#include <boost/serialization/tracking.hpp>
 #include "repast_hpc/AgentId.h"
 #include "disease.h"
+#include "agent.h"
 //content is a bit overspecified at the moment as it tries to cover cohorts, stocks and humans
 //however, not obvious to me how to change this! (tried with polymorphic pointers, but massive memory leaks or seg. faults)
 //NB to get boost serialize to a file to work data here has to be initialized - otherwise it crashes with an error on archive input.
+//Everything here is fixed size plain data, so packages are sent as raw bytes (an MPI derived datatype / bitwise copy) rather than field by field.
 struct content {
     content(){}
+    //groups of fields that are valid in this package - ghost updates only fill in the groups that have changed (see Human::_dirty),
+    //and only those are copied out at the other end
+    enum fieldGroups {otherFields=1,aliveField=2,diseaseFields=4,locationFields=8,allFields=15};
+    unsigned char _fields=allFields;
     int _sequencer=0;
     unsigned _FunctionalGroupIndex=0;   
               
@@ -65,15 +76,16 @@ struct content {
     bool _IsMature=false;    
    
     bool _moved=false;
-    char _sex;
+    char _sex='f';
 
-    std::map<std::string,disease> _diseases;
-    std::vector<double> _location={0,0},_destination={0,0};
+    //indexed by DiseaseRegistry id, as in Human
+    disease _diseases[DiseaseRegistry::MaxDiseases];
+    Coordinates _location,_destination;
     
 	template<class Archive>
 	void serialize(Archive& ar, const unsigned int version) {
 
-
+        ar & _fields;
         ar & _sequencer;
         ar & _FunctionalGroupIndex;   
                 
@@ -97,15 +109,16 @@ struct content {
 };
 
 struct AgentPackage {
-    AgentPackage(){}
-    AgentPackage(repast::AgentId ID):_id(ID){}
+    AgentPackage(){_id[0]=0;_id[1]=0;_id[2]=0;_id[3]=0;}
+    AgentPackage(repast::AgentId ID){setId(ID);}
 	repast::AgentId getId() const {
-		return _id;
+		return repast::AgentId(_id[0],_id[1],_id[2],_id[3]);
 	}
 	void setId(repast::AgentId ID)  {
-      _id=ID;
+      _id[0]=ID.id();_id[1]=ID.startingRank();_id[2]=ID.agentType();_id[3]=ID.currentRank();
 	}
-    repast::AgentId _id;
+    //the AgentId as plain ints: id, starting rank, agent type, current rank
+    int _id[4];
     
     content _contents;
     
@@ -117,6 +130,19 @@ struct AgentPackage {
 	}
 
 };
-
+static_assert(std::is_trivially_copyable<AgentPackage>::value,"AgentPackage is sent as raw bytes, so must be trivially copyable");
+//restart archives start with this number. Packages are archived as raw bytes, so any change to the package layout makes
+//old restart files unreadable - change the number with it. Files from before the number existed start with the package count.
+//The size of the position encoding is part of the number, so builds with and without QUANTISED_POSITIONS reject each other's files.
+const unsigned restartFormat=0x52530003+0x100*sizeof(Coordinates);
+
+BOOST_IS_MPI_DATATYPE(content)
+BOOST_IS_BITWISE_SERIALIZABLE(content)
+BOOST_CLASS_IMPLEMENTATION(content,object_serializable)
+BOOST_CLASS_TRACKING(content,track_never)
+BOOST_IS_MPI_DATATYPE(AgentPackage)
+BOOST_IS_BITWISE_SERIALIZABLE(AgentPackage)
+BOOST_CLASS_IMPLEMENTATION(AgentPackage,object_serializable)
+BOOST_CLASS_TRACKING(AgentPackage,track_never)
 
 #endif /* AGENTCONTENT_H_ */
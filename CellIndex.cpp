@@ -0,0 +1,294 @@
+/*
+ *
+ * CellIndex.cpp
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+#include "CellIndex.h"
+
+CellIndex::CellIndex():_range(-1),_xlo(0),_xhi(0),_ylo(0),_yhi(0),_bx0(0),_by0(0),_nx(0),_ny(0),_width(1),_height(1){}
+//------------------------------------------------------------------------------------------------------------
+void CellIndex::setup(int xlo,int xhi,int ylo,int yhi,int halo,int minX,int maxX,int minY,int maxY){
+    _xlo=xlo;_xhi=xhi;_ylo=ylo;_yhi=yhi;
+    _width =maxX-minX+1;
+    _height=maxY-minY+1;
+    //no halo in a direction where this rank already spans the whole grid - the wrapped neighbours are then local cells
+    int hx=halo,hy=halo;
+    if (_xhi-_xlo+2*hx>_width ) hx=0;
+    if (_yhi-_ylo+2*hy>_height) hy=0;
+    _bx0=_xlo-hx;_nx=_xhi-_xlo+2*hx;
+    _by0=_ylo-hy;_ny=_yhi-_ylo+2*hy;
+    _cells.clear();
+    _cells.resize(_nx*_ny);
+    _columns.clear();
+    _columns.resize(_nx*_ny);
+    _infectiousBuckets.resize(_nx*_ny);
+    _inRangeBuckets.resize(_nx*_ny);
+    _infectiousInRange.assign(_nx*_ny,0);
+    _changed.clear();
+    _isChanged.assign(_nx*_ny,0);
+    _range=-1;
+}
+//------------------------------------------------------------------------------------------------------------
+int CellIndex::index(int x,int y) const{
+    //the repast space wraps in both directions, so bring x,y into the box starting at _bx0,_by0 before testing
+    int dx=(x-_bx0)%_width;  if (dx<0)dx+=_width;
+    int dy=(y-_by0)%_height; if (dy<0)dy+=_height;
+    if (dx>=_nx || dy>=_ny) return -1;
+    return dx+_nx*dy;
+}
+//------------------------------------------------------------------------------------------------------------
+bool CellIndex::isLocalIndex(int i) const{
+    if (i<0 || i>=int(_cells.size())) return false;
+    return isLocal(_bx0+i%_nx,_by0+i/_nx);
+}
+//------------------------------------------------------------------------------------------------------------
+std::vector<MadAgent*>* CellIndex::cell(int x,int y){
+    int i=index(x,y);
+    if (i<0) return NULL;
+    return &_cells[i];
+}
+//------------------------------------------------------------------------------------------------------------
+const CellColumns* CellIndex::columnsAt(int x,int y) const{
+    int i=index(x,y);
+    if (i<0) return NULL;
+    return &_columns[i];
+}
+//------------------------------------------------------------------------------------------------------------
+void CellIndex::add(MadAgent* a,int x,int y,uint8_t state){
+    int i=index(x,y);
+    a->_cellIndex=i;
+    if (i<0) return;
+    a->_cellSlot=_cells[i].size();
+    _cells[i].push_back(a);
+    if (_columns[i].push_back(a->_location[0],a->_location[1],state))noteChange(i);
+}
+//------------------------------------------------------------------------------------------------------------
+void CellIndex::remove(MadAgent* a){
+    if (!contains(a)) {a->_cellIndex=-1;return;}
+    std::vector<MadAgent*>& c=_cells[a->_cellIndex];
+    CellColumns& k=_columns[a->_cellIndex];
+    unsigned s=a->_cellSlot;
+    MadAgent* last=c.back();
+    c[s]=last;
+    if (k.moveLastTo(s))noteChange(a->_cellIndex);
+    last->_cellSlot=s;
+    c.pop_back();
+    a->_cellIndex=-1;
+}
+//------------------------------------------------------------------------------------------------------------
+void CellIndex::move(MadAgent* a,int x,int y,uint8_t state){
+    int i=index(x,y);
+    if (i>=0 && i==a->_cellIndex && contains(a)) {refresh(a,state);return;}
+    remove(a);
+    add(a,x,y,state);
+}
+//------------------------------------------------------------------------------------------------------------
+void CellIndex::refresh(MadAgent* a,uint8_t state){
+    if (!contains(a)) return;
+    CellColumns& c=_columns[a->_cellIndex];
+    c._x[a->_cellSlot]=a->_location[0];
+    c._y[a->_cellSlot]=a->_location[1];
+    if (c.set(a->_cellSlot,state))noteChange(a->_cellIndex);
+}
+//------------------------------------------------------------------------------------------------------------
+void CellIndex::refreshLocation(MadAgent* a){
+    if (!contains(a)) return;
+    CellColumns& c=_columns[a->_cellIndex];
+    c._x[a->_cellSlot]=a->_location[0];
+    c._y[a->_cellSlot]=a->_location[1];
+}
+//------------------------------------------------------------------------------------------------------------
+bool CellIndex::contains(MadAgent* a) const{
+    int i=a->_cellIndex;
+    if (i<0 || i>=int(_cells.size())) return false;
+    return a->_cellSlot<_cells[i].size() && _cells[i][a->_cellSlot]==a;
+}
+//------------------------------------------------------------------------------------------------------------
+void CellIndex::clearHalo(){
+    for (int i=0;i<int(_cells.size());i++) if (!isLocalIndex(i)) {
+        if (_columns[i]._infectious>0)noteChange(i);
+        _cells[i].clear();
+        _columns[i].clear();
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+size_t CellIndex::bytes() const{
+    size_t n=_cells.capacity()*sizeof(std::vector<MadAgent*>)+_columns.capacity()*sizeof(CellColumns);
+    for (auto& c:_cells)n+=c.capacity()*sizeof(MadAgent*);
+    for (auto& c:_columns){
+        n+=(c._x.capacity()+c._y.capacity())*sizeof(double);
+        for (auto& p:c._planes)n+=p.capacity()*sizeof(uint64_t);
+    }
+    return n;
+}
+//------------------------------------------------------------------------------------------------------------
+void CellIndex::clear(){
+    for (int i=0;i<int(_cells.size());i++) {
+        if (_columns[i]._infectious>0)noteChange(i);
+        _cells[i].clear();
+        _columns[i].clear();
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned CellIndex::infectiousAt(int x,int y) const{
+    int i=index(x,y);
+    if (i<0) return 0;
+    return infectious(i);
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned CellIndex::tallyAt(int x,int y,unsigned compartment) const{
+    int i=index(x,y);
+    if (i<0) return 0;
+    return tally(i,compartment);
+}
+//------------------------------------------------------------------------------------------------------------
+//cells may change on several threads at once, but moving between zero and non-zero infectious agents is rare, so a critical section will do
+void CellIndex::noteChange(int i){
+    #pragma omp critical(cellIndexChanges)
+    {
+    if (!_isChanged[i]){_isChanged[i]=1;_changed.push_back(i);}
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+void CellIndex::updateInfectious(int range){
+    if (range!=_range){
+        //start again: every bucket is checked as if it had changed, against empty sets
+        _range=range;
+        _infectiousBuckets.resize(_cells.size());
+        _inRangeBuckets.resize(_cells.size());
+        _infectiousInRange.assign(_cells.size(),0);
+        _changed.clear();
+        for (int i=0;i<int(_cells.size());i++){_isChanged[i]=1;_changed.push_back(i);}
+    }
+    for (int i:_changed){
+        _isChanged[i]=0;
+        //a cell may have moved both ways since the last call, so only its current state matters
+        bool now=(_columns[i]._infectious>0);
+        if (now==_infectiousBuckets.has(i)) continue;
+        if (now)_infectiousBuckets.insert(i); else _infectiousBuckets.erase(i);
+        countInRange(i,now ? 1 : -1);
+    }
+    _changed.clear();
+}
+//------------------------------------------------------------------------------------------------------------
+//add change to the count of infectious buckets in range of each local bucket within range of bucket i
+void CellIndex::countInRange(int i,int change){
+    int x,y;
+    coordinates(i,x,y);
+    for (int dx=-_range;dx<=_range;dx++){
+        for (int dy=-_range;dy<=_range;dy++){
+            int j=index(x+dx,y+dy);
+            if (!isLocalIndex(j)) continue;
+            _infectiousInRange[j]+=change;
+            if (_infectiousInRange[j]>0)_inRangeBuckets.insert(j); else _inRangeBuckets.erase(j);
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+void CellIndex::BucketSet::erase(int i){
+    if (!has(i)) return;
+    int last=_members.back();
+    _members[_position[i]]=last;
+    _position[last]=_position[i];
+    _members.pop_back();
+    _position[i]=-1;
+}
+//------------------------------------------------------------------------------------------------------------
+// CellColumns
+//------------------------------------------------------------------------------------------------------------
+uint8_t CellColumns::state(unsigned slot) const{
+    uint8_t s=0;
+    unsigned w=slot/64,b=slot%64;
+    for (unsigned f=0;f<numberOfFlags;f++)s|=uint8_t((_planes[f][w]>>b)&1)<<f;
+    return s;
+}
+//------------------------------------------------------------------------------------------------------------
+bool CellColumns::set(unsigned slot,uint8_t state){
+    uint8_t was=this->state(slot);
+    unsigned from=compartmentOf(was),to=compartmentOf(state);
+    //a busy cell may be split between threads, so the tallies can change from more than one thread at once
+    if (from!=to){
+        if (from!=noCompartment){
+            #pragma omp atomic
+            _tallies[from]--;
+        }
+        if (to!=noCompartment){
+            #pragma omp atomic
+            _tallies[to]++;
+        }
+    }
+    bool changed=false;
+    if ((was^state)&infectious){
+        unsigned before;
+        if (state&infectious){
+            #pragma omp atomic capture
+            before=_infectious++;
+            changed=(before==0);
+        }else{
+            #pragma omp atomic capture
+            before=_infectious--;
+            changed=(before==1);
+        }
+    }
+    unsigned w=slot/64;
+    uint64_t bit=uint64_t(1)<<(slot%64);
+    for (unsigned f=0;f<numberOfFlags;f++){
+        if ((state>>f)&1)_planes[f][w]|= bit;
+        else             _planes[f][w]&=~bit;
+    }
+    return changed;
+}
+//------------------------------------------------------------------------------------------------------------
+bool CellColumns::push_back(double x,double y,uint8_t state){
+    _x.push_back(x);
+    _y.push_back(y);
+    if (_size%64==0)for (auto& p:_planes)p.push_back(0);
+    _size++;
+    return set(_size-1,state);
+}
+//------------------------------------------------------------------------------------------------------------
+bool CellColumns::moveLastTo(unsigned s){
+    unsigned last=_size-1;
+    _x[s]=_x[last];_y[s]=_y[last];
+    //either set can change the count (the slot being dropped may be infectious), but overall it moves at most once
+    unsigned before=_infectious;
+    set(s,state(last));
+    set(last,0);
+    _x.pop_back();_y.pop_back();
+    _size--;
+    if (_size%64==0)for (auto& p:_planes)p.pop_back();
+    return (before==0)!=(_infectious==0);
+}
+//------------------------------------------------------------------------------------------------------------
+void CellColumns::clear(){
+    _x.clear();_y.clear();
+    for (auto& p:_planes)p.clear();
+    _tallies.fill(0);
+    _infectious=0;
+    _size=0;
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned CellColumns::count(uint8_t with,uint8_t without) const{
+    unsigned n=0;
+    for (unsigned w=0;w<_planes[0].size();w++){
+        uint64_t bits=~uint64_t(0);
+        for (unsigned f=0;f<numberOfFlags;f++){
+            if ((with   >>f)&1)bits&= _planes[f][w];
+            if ((without>>f)&1)bits&=~_planes[f][w];
+        }
+        n+=__builtin_popcountll(bits);
+    }
+    return n;
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned CellColumns::recount(unsigned c) const{
+    switch (c){
+        case S: return count(localHuman|susceptible);
+        case I: return count(localHuman|alive,susceptible|recovered);
+        case R: return count(localHuman|alive|recovered,susceptible);
+        case D: return count(localHuman,susceptible|alive);
+    }
+    return 0;
+}
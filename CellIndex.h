@@ -0,0 +1,138 @@
+/*
+ *
+ * CellIndex.h
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+
+#ifndef CELLINDEX_H
+#define CELLINDEX_H
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "agent.h"
+//------------------------------------------------------------------------------------------
+//Per-rank index of agents bucketed by grid cell. Covers the local part of the grid plus a halo
+//of buffer cells (if any), so that cell passes in the model can walk a contiguous list of agents per cell
+//instead of building repast grid queries (which go through hash lookups in SharedDiscreteSpace).
+//Agents record which bucket they are in (MadAgent::_cellIndex and _cellSlot) so that removal is a swap-and-pop.
+//The local part is maintained incrementally by the model whenever agents are added, removed or moved;
+//the halo holds ghost copies which repast re-creates on every sync, so it is rebuilt after sync instead.
+//Alongside the agent pointers each bucket holds columns of the fields the cell passes filter on, in the same slot order, so that
+//those passes stream over contiguous arrays and only dereference the agents they actually act on: positions, and the state flags
+//bit-sliced - one bitset per flag with one bit per slot. The agents remain the owners of their data (repast needs real agent objects
+//to move and copy between threads) - the model refreshes an agent's columns whenever it changes position or disease state.
+//Counts of agents with a combination of flags are popcounts over a few words per cell. Each cell also keeps a count of local humans per S/I/R/D
+//compartment, and of infectious agents, changed only when a slot's state moves between them - totals and maps are then a pass over cells.
+//Cells whose infectious count moves between zero and non-zero are noted, so the index can keep the cells with something to pass on,
+//and the local cells within range of one, up to date without rescanning the grid (see updateInfectious).
+//------------------------------------------------------------------------------------------
+struct CellColumns {
+    enum flags{alive=1,localHuman=2,susceptible=4,infectious=8,recovered=16,numberOfFlags=5};
+    //as counted in the model outputs: anyone without covid is susceptible, those with it are infected or recovered while alive, or dead
+    enum compartments{S=0,I=1,R=2,D=3,numberOfCompartments=4,noCompartment=4};
+    static unsigned compartmentOf(uint8_t state){
+        if (!(state&localHuman)) return noCompartment;
+        if (state&susceptible)   return S;
+        if (!(state&alive))      return D;
+        return (state&recovered) ? R : I;
+    }
+    std::vector<double> _x,_y;
+    //bit slot%64 of word slot/64 of plane f is flag 1<<f for the agent in that slot - bits past the last slot are always clear
+    std::array<std::vector<uint64_t>,numberOfFlags> _planes;
+    unsigned _size;
+    //local humans in each compartment, and agents flagged infectious, kept in step with the planes by set
+    std::array<unsigned,numberOfCompartments> _tallies;
+    unsigned _infectious;
+    CellColumns():_size(0),_tallies{0,0,0,0},_infectious(0){}
+    unsigned size() const {return _size;}
+    uint8_t state(unsigned slot) const;
+    bool has(unsigned slot,uint8_t f) const {return (state(slot)&f)==f;}
+    //set the state of one slot - threads may set slots in the same cell at once only if they are in different words
+    //(CellScheduler splits cells on multiples of 64 agents). Returns true if the number of infectious agents moved between zero and non-zero
+    bool set(unsigned slot,uint8_t state);
+    bool push_back(double x,double y,uint8_t state);
+    //copy the last slot into slot s and drop the last slot
+    bool moveLastTo(unsigned s);
+    void clear();
+    //number of slots with all the flags in with set and all those in without clear
+    unsigned count(uint8_t with,uint8_t without=0) const;
+    unsigned compartment(unsigned c) const {return _tallies[c];}
+    //the same from the planes
+    unsigned recount(unsigned c) const;
+};
+//------------------------------------------------------------------------------------------
+class CellIndex {
+public:
+    CellIndex();
+    void setup(int xlo,int xhi,int ylo,int yhi,int halo,int minX,int maxX,int minY,int maxY);
+    //bucket number for grid cell x,y (wrapped as for the repast space), or -1 if not held on this rank
+    int  index(int x,int y) const;
+    bool isLocal(int x,int y) const {return x>=_xlo && x<_xhi && y>=_ylo && y<_yhi;}
+    bool isLocalIndex(int i) const;
+    //agents in cell x,y - NULL if the cell is outside the local grid plus halo
+    std::vector<MadAgent*>* cell(int x,int y);
+    std::vector<MadAgent*>& bucket(int i){return _cells[i];}
+    unsigned numberOfBuckets() const {return _cells.size();}
+    //heap bytes held by the buckets and columns, including unused capacity
+    size_t bytes() const;
+    bool hasHalo() const {return _nx*_ny>(_xhi-_xlo)*(_yhi-_ylo);}
+    //state is the CellColumns flags for the agent
+    void add(MadAgent*,int x,int y,uint8_t state);
+    void remove(MadAgent*);
+    void move(MadAgent*,int x,int y,uint8_t state);
+    //copy the agent's current position and state into its columns (no-op if it is not in the index)
+    void refresh(MadAgent*,uint8_t state);
+    //position only, keeping the state flags
+    void refreshLocation(MadAgent*);
+    const CellColumns& columns(int i) const {return _columns[i];}
+    //columns for cell x,y - NULL if the cell is outside the local grid plus halo
+    const CellColumns* columnsAt(int x,int y) const;
+    //true if the agent pointer is currently held in the bucket it claims to be in - does not dereference stale pointers in the index
+    bool contains(MadAgent*) const;
+    void clearHalo();
+    //empty every bucket, local and halo
+    void clear();
+    //number of infectious agents in a bucket, or in cell x,y (0 if not held on this rank)
+    unsigned infectious(int i) const {return _columns[i]._infectious;}
+    unsigned infectiousAt(int x,int y) const;
+    //number of local humans in a compartment in a bucket, or in cell x,y (0 if not held on this rank)
+    unsigned tally(int i,unsigned compartment) const {return _columns[i].compartment(compartment);}
+    unsigned tallyAt(int x,int y,unsigned compartment) const;
+    //grid cell of bucket i (in the box around the local grid, so possibly off the edge of the grid where it wraps)
+    void coordinates(int i,int& x,int& y) const {x=_bx0+i%_nx;y=_by0+i/_nx;}
+    //bring the infectious buckets, and the local buckets with an infectious bucket within range, up to date with the cells noted as changed
+    //since the last call - a change of range recounts from scratch
+    void updateInfectious(int range);
+    const std::vector<int>& infectiousBuckets() const {return _infectiousBuckets.members();}
+    const std::vector<int>& inRangeBuckets() const {return _inRangeBuckets.members();}
+
+private:
+    //a set of bucket numbers that can be added to, removed from, and listed in O(1) per member
+    class BucketSet {
+    public:
+        void resize(unsigned n){_members.clear();_position.assign(n,-1);}
+        bool has(int i) const {return _position[i]>=0;}
+        void insert(int i){if (!has(i)){_position[i]=_members.size();_members.push_back(i);}}
+        void erase(int i);
+        const std::vector<int>& members() const {return _members;}
+    private:
+        std::vector<int> _members,_position;
+    };
+    void noteChange(int i);
+    void countInRange(int i,int change);
+    int _range;
+    BucketSet _infectiousBuckets,_inRangeBuckets;
+    //number of infectious buckets within range of each local bucket
+    std::vector<unsigned> _infectiousInRange;
+    //buckets whose infectious count has moved between zero and non-zero since the last updateInfectious
+    std::vector<int> _changed;
+    std::vector<char> _isChanged;
+    int _xlo,_xhi,_ylo,_yhi;
+    int _bx0,_by0,_nx,_ny;
+    int _width,_height;
+    std::vector< std::vector<MadAgent*> > _cells;
+    std::vector<CellColumns> _columns;
+};
+#endif
@@ -0,0 +1,73 @@
+/*
+ *
+ * CellScheduler.cpp
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+#include <algorithm>
+#include "CellScheduler.h"
+
+CellScheduler::CellScheduler():_threads(1),_splitSize(0){setup(1,0);}
+//------------------------------------------------------------------------------------------------------------
+void CellScheduler::setup(unsigned threads,unsigned splitSize){
+    _threads=std::max(threads,1u);
+    //sub-tasks start on a multiple of 64 agents, so threads never share a word of the bit-sliced CellColumns state
+    _splitSize=((splitSize+63)/64)*64;
+    _queues.assign(_threads,std::deque<CellTask>());
+    _locks.reset(new std::mutex[_threads]);
+    _busy.assign(_threads,0.);
+    _tasks.clear();
+}
+//------------------------------------------------------------------------------------------------------------
+void CellScheduler::clear(){
+    _tasks.clear();
+}
+//------------------------------------------------------------------------------------------------------------
+void CellScheduler::add(int x,int y,unsigned n,double weight,bool split){
+    if (n==0) return;
+    if (!split || _splitSize==0 || n<=_splitSize){
+        _tasks.push_back({x,y,0,n,weight});
+        return;
+    }
+    //share the weight out in proportion to the number of agents in each piece
+    for (unsigned first=0;first<n;first+=_splitSize){
+        unsigned last=std::min(first+_splitSize,n);
+        _tasks.push_back({x,y,first,last,weight*(last-first)/n+1});
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+void CellScheduler::deal(){
+    //heaviest first, each to the thread with the least work so far - stealing then only has to even out errors in the estimates
+    std::sort(_tasks.begin(),_tasks.end(),[](const CellTask& a,const CellTask& b){return a._weight>b._weight;});
+    std::vector<double> load(_threads,0.);
+    for (auto& q:_queues)q.clear();
+    for (auto& task:_tasks){
+        unsigned t=std::min_element(load.begin(),load.end())-load.begin();
+        _queues[t].push_back(task);
+        load[t]+=task._weight;
+    }
+    _tasks.clear();
+}
+//------------------------------------------------------------------------------------------------------------
+bool CellScheduler::next(unsigned thread,CellTask& task){
+    {
+        std::lock_guard<std::mutex> lock(_locks[thread]);
+        if (!_queues[thread].empty()){
+            task=_queues[thread].front();
+            _queues[thread].pop_front();
+            return true;
+        }
+    }
+    //own queue is empty - steal the lightest remaining task from another thread
+    for (unsigned i=1;i<_threads;i++){
+        unsigned victim=(thread+i)%_threads;
+        std::lock_guard<std::mutex> lock(_locks[victim]);
+        if (!_queues[victim].empty()){
+            task=_queues[victim].back();
+            _queues[victim].pop_back();
+            return true;
+        }
+    }
+    return false;
+}
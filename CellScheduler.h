@@ -0,0 +1,66 @@
+/*
+ *
+ * CellScheduler.h
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+
+#ifndef CELLSCHEDULER_H
+#define CELLSCHEDULER_H
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <utility>
+#include "RandomStreams.h"
+//------------------------------------------------------------------------------------------
+//Shares the per-cell passes in MadModel::step across threads. The number of agents in a cell varies by orders of magnitude
+//between towns and countryside, so a static split of the grid leaves threads idle. Instead each pass is broken into tasks
+//weighted by an occupancy estimate: cells with more than splitSize agents are split into sub-tasks (ranges of the cell's agent list)
+//where the pass allows it. Tasks are dealt heaviest first to the least loaded thread; a thread that runs out takes tasks
+//from the back of another thread's queue. Time spent running tasks is accumulated per thread so that imbalance can be reported.
+//------------------------------------------------------------------------------------------
+struct CellTask {
+    int _x,_y;
+    //range of the cell's agent list this task covers
+    unsigned _first,_last;
+    double _weight;
+};
+//------------------------------------------------------------------------------------------
+class CellScheduler {
+public:
+    CellScheduler();
+    void setup(unsigned threads,unsigned splitSize);
+    //start a new set of tasks
+    void clear();
+    //add cell x,y holding n agents with estimated cost weight - split into sub-tasks of at most splitSize agents if allowed
+    void add(int x,int y,unsigned n,double weight,bool split);
+    //run f(task) on every task, spread over threads
+    template <class F> void run(F f){
+        deal();
+        #pragma omp parallel
+        {
+        unsigned t=RandomStreams::threadNumber();
+        CellTask task;
+        while (next(t,task)){
+            auto start=std::chrono::steady_clock::now();
+            f(task);
+            _busy[t]+=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        }
+        }
+    }
+    unsigned threads() const {return _threads;}
+    //seconds each thread has spent running tasks since setup
+    const std::vector<double>& busyTime() const {return _busy;}
+private:
+    void deal();
+    bool next(unsigned thread,CellTask&);
+    unsigned _threads,_splitSize;
+    std::vector<CellTask> _tasks;
+    std::vector< std::deque<CellTask> > _queues;
+    std::unique_ptr<std::mutex[]> _locks;
+    std::vector<double> _busy;
+};
+#endif
@@ -0,0 +1,163 @@
+/*
+ *
+ * CompartmentCells.cpp
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+#include <math.h>
+#include "CompartmentCells.h"
+#include "Human.h"
+#include "disease.h"
+#include "RankNeighbours.h"
+#include <mpi.h>
+
+//HaloExchange uses tags below 32 on the RankNeighbours communicator
+static const int countTag=32,edgeTag=33;
+
+CompartmentCells::CompartmentCells():_xlo(0),_xhi(0),_ylo(0),_yhi(0),_minX(0),_maxX(0),_minY(0),_maxY(0),_noLongitudeWrap(true),_infectionProb(0),_weight(1){}
+//------------------------------------------------------------------------------------------------------------
+void CompartmentCells::setup(int xlo,int xhi,int ylo,int yhi,int minX,int maxX,int minY,int maxY,bool noLongitudeWrap,double weight){
+    _weight=weight;
+    _xlo=xlo;_xhi=xhi;_ylo=ylo;_yhi=yhi;
+    _minX=minX;_maxX=maxX;_minY=minY;_maxY=maxY;
+    _noLongitudeWrap=noLongitudeWrap;
+    //follow a disease from infection to recovery so that the counts progress in the same way as individuals do
+    disease d;
+    _infectionProb=d.infectionProb();
+    d.infect();
+    _infectious.clear();
+    while (!d.recovered() && _infectious.size()<100000){
+        _infectious.push_back(d.infectious());
+        d.update();
+    }
+    clear();
+}
+//------------------------------------------------------------------------------------------------------------
+void CompartmentCells::clear(){
+    unsigned n=(_xhi-_xlo)*(_yhi-_ylo);
+    _mode.assign(n,aggregate);
+    _infected.assign(n,std::vector<unsigned>(steps()*SusceptiblePool::numberOfSexes,0));
+    _recovered.assign(n,std::array<unsigned,SusceptiblePool::numberOfSexes>{0,0});
+    _globalInfectious.assign((_maxX-_minX+1)*(_maxY-_minY+1),0.);
+    _filled.clear();
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned CompartmentCells::infected(int x,int y) const{
+    unsigned total=0;
+    for (auto c:_infected[index(x,y)])total+=c;
+    return total;
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned CompartmentCells::infectious(int x,int y) const{
+    const std::vector<unsigned>& c=_infected[index(x,y)];
+    unsigned total=0;
+    for (unsigned n=0;n<steps();n++)if (_infectious[n])for (unsigned s=0;s<SusceptiblePool::numberOfSexes;s++)total+=c[n*SusceptiblePool::numberOfSexes+s];
+    return total;
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned CompartmentCells::recovered(int x,int y) const{
+    const std::array<unsigned,SusceptiblePool::numberOfSexes>& r=_recovered[index(x,y)];
+    return r[SusceptiblePool::female]+r[SusceptiblePool::male];
+}
+//------------------------------------------------------------------------------------------------------------
+void CompartmentCells::add(int x,int y,Human* h){
+    unsigned sex=SusceptiblePool::female;
+    if (h->_sex=='m')sex=SusceptiblePool::male;
+    disease& d=h->_diseases[DiseaseRegistry::covid];
+    if (d.recovered() || d.timer()>=steps()) recoveredCount(x,y,sex)++;
+    else infectedCount(x,y,d.timer(),sex)++;
+}
+//------------------------------------------------------------------------------------------------------------
+void CompartmentCells::update(int x,int y){
+    std::vector<unsigned>& c=_infected[index(x,y)];
+    unsigned sexes=SusceptiblePool::numberOfSexes;
+    for (unsigned s=0;s<sexes;s++)recoveredCount(x,y,s)+=c[(steps()-1)*sexes+s];
+    for (unsigned n=steps()-1;n>0;n--)for (unsigned s=0;s<sexes;s++)c[n*sexes+s]=c[(n-1)*sexes+s];
+    for (unsigned s=0;s<sexes;s++)c[s]=0;
+}
+//------------------------------------------------------------------------------------------------------------
+void CompartmentCells::exchange(bool withOtherRanks,const RankNeighbours& ranks,int range){
+    for (auto g:_filled)_globalInfectious[g]=0;
+    _filled.clear();
+    //only cells within range of the edge can be reached from another rank - sent as x,y,count for those with anyone infectious
+    std::vector<double> edge;
+    for(int y = _ylo; y < _yhi; y++){
+        for(int x = _xlo; x < _xhi; x++){
+            unsigned n=infectious(x,y);
+            if (n==0) continue;
+            int g=globalIndex(x,y);
+            _globalInfectious[g]=n;
+            _filled.push_back(g);
+            if (x<_xlo+range || x>=_xhi-range || y<_ylo+range || y>=_yhi-range){edge.push_back(x);edge.push_back(y);edge.push_back(n);}
+        }
+    }
+    if (!withOtherRanks) return;
+    MPI_Comm comm=ranks.communicator();
+    int rank;
+    MPI_Comm_rank(comm,&rank);
+    std::vector<int> others;
+    for (auto r:ranks.neighbours())if (r!=rank)others.push_back(r);
+    unsigned k=others.size();
+    int size=edge.size();
+    std::vector<int> sizes(k,0);
+    std::vector<MPI_Request> requests(2*k);
+    for (unsigned r=0;r<k;r++)MPI_Irecv(&sizes[r],1,MPI_INT,others[r],countTag,comm,&requests[r]);
+    for (unsigned r=0;r<k;r++)MPI_Isend(&size,1,MPI_INT,others[r],countTag,comm,&requests[k+r]);
+    MPI_Waitall(requests.size(),requests.data(),MPI_STATUSES_IGNORE);
+    std::vector< std::vector<double> > received(k);
+    for (unsigned r=0;r<k;r++){
+        received[r].resize(sizes[r]);
+        MPI_Irecv(received[r].data(),sizes[r],MPI_DOUBLE,others[r],edgeTag,comm,&requests[r]);
+    }
+    for (unsigned r=0;r<k;r++)MPI_Isend(edge.data(),size,MPI_DOUBLE,others[r],edgeTag,comm,&requests[k+r]);
+    MPI_Waitall(requests.size(),requests.data(),MPI_STATUSES_IGNORE);
+    for (auto& cells:received){
+        for (unsigned c=0;c+2<cells.size();c+=3){
+            int g=globalIndex(int(cells[c]),int(cells[c+1]));
+            if (g<0) continue;
+            _globalInfectious[g]=cells[c+2];
+            _filled.push_back(g);
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+size_t CompartmentCells::bytes() const{
+    size_t n=_infectious.capacity()/8+_mode.capacity()*sizeof(modes)+_infected.capacity()*sizeof(std::vector<unsigned>)
+            +_recovered.capacity()*sizeof(_recovered[0])+_globalInfectious.capacity()*sizeof(double)+_filled.capacity()*sizeof(int);
+    for (auto& c:_infected)n+=c.capacity()*sizeof(unsigned);
+    return n;
+}
+//------------------------------------------------------------------------------------------------------------
+int CompartmentCells::globalIndex(int x,int y) const{
+    int width=_maxX-_minX+1;
+    if (y<_minY || y>_maxY) return -1;
+    if (x<_minX || x>_maxX){
+        if (_noLongitudeWrap) return -1;
+        x=_minX+((x-_minX)%width+width)%width;
+    }
+    return (x-_minX)+width*(y-_minY);
+}
+//------------------------------------------------------------------------------------------------------------
+void CompartmentCells::addSources(int x,int y,int range,std::map<unsigned,double>& logEscape) const{
+    for (int i=-range;i<=range;i++){
+        for (int j=-range;j<=range;j++){
+            int g=globalIndex(x+i,y+j);
+            if (g<0 || _globalInfectious[g]==0) continue;
+            //chance that a uniformly placed infectious person is in range of a uniformly placed susceptible, per dimension (range is at most 1)
+            double overlap=(i==0 ? 1. : 0.5)*(j==0 ? 1. : 0.5);
+            double p=_infectionProb*overlap;
+            logEscape[DiseaseRegistry::covid]+=_weight*_globalInfectious[g]*((p<1.) ? log(1.-p) : -1.e3);
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+bool CompartmentCells::infectiousInRange(int x,int y,int range) const{
+    for (int i=-range;i<=range;i++){
+        for (int j=-range;j<=range;j++){
+            int g=globalIndex(x+i,y+j);
+            if (g>=0 && _globalInfectious[g]>0) return true;
+        }
+    }
+    return false;
+}
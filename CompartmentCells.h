@@ -0,0 +1,82 @@
+/*
+ *
+ * CompartmentCells.h
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+
+#ifndef COMPARTMENTCELLS_H
+#define COMPARTMENTCELLS_H
+#include <vector>
+#include <array>
+#include <map>
+#include <string>
+#include "SusceptiblePool.h"
+class Human;
+class RankNeighbours;
+//------------------------------------------------------------------------------------------
+//Aggregate (count based) representation of covid for the local cells (simulation.HybridCells=true).
+//Infected people in an aggregate cell are counted by sex and by the number of steps since infection, so that they progress
+//exactly as individual diseases do (the state for each step count is taken from the disease class itself); once recovered they
+//move to a recovered count. Susceptibles are in the SusceptiblePool in either representation.
+//Each cell is either aggregate or individual: MadModel::rebalanceCells promotes a cell to individual humans when it has only
+//a few infections (where chance events matter) and demotes it back to counts when the epidemic there is large or has died out.
+//Counted infectious people have no position, so are taken to be uniformly spread over their cell: for pooled susceptibles
+//in the same cell every pair is in range, and for the adjacent cell in one direction half of them are.
+//------------------------------------------------------------------------------------------
+class CompartmentCells {
+public:
+    enum modes {aggregate=0,individual=1};
+    //compartment restart files (MadModel::writeCompartmentRestart) start with this - change it if the layout of the counts changes
+    static const unsigned restartFormat=0x43430001;
+    CompartmentCells();
+    void setup(int xlo,int xhi,int ylo,int yhi,int minX,int maxX,int minY,int maxY,bool noLongitudeWrap,double weight=1);
+    void clear();
+    bool isIndividual(int x,int y) const {return _mode[index(x,y)]==individual;}
+    void setMode(int x,int y,modes m){_mode[index(x,y)]=m;}
+    //number of counted people of a given sex infected n steps ago (n < steps()), or recovered
+    unsigned& infectedCount(int x,int y,unsigned n,unsigned sex){return _infected[index(x,y)][n*SusceptiblePool::numberOfSexes+sex];}
+    unsigned& recoveredCount(int x,int y,unsigned sex){return _recovered[index(x,y)][sex];}
+    //number of steps an infection lasts before recovery
+    unsigned steps() const {return _infectious.size();}
+    //totals over sex and time since infection
+    unsigned infected(int x,int y) const;
+    unsigned infectious(int x,int y) const;
+    unsigned recovered(int x,int y) const;
+    //newly infected people (from the pool)
+    void infect(int x,int y,unsigned sex,unsigned n){infectedCount(x,y,0,sex)+=n;}
+    //add an individual human's covid state to the counts
+    void add(int x,int y,Human*);
+    //the equivalent of disease::update for everyone counted in the cell
+    void update(int x,int y);
+    //state of a disease n updates after infection
+    bool isInfectious(unsigned n) const {return _infectious[n];}
+    //collect the infectious counts of local cells, and if withOtherRanks also those of cells on neighbouring ranks within range
+    //of the edge of this one - needed if pool infection reaches into neighbouring cells
+    void exchange(bool withOtherRanks,const RankNeighbours&,int range);
+    //add the chance of infection from counted infectious people within range of cell x,y to the log escape probabilities
+    void addSources(int x,int y,int range,std::map<unsigned,double>& logEscape) const;
+    //true if there are counted infectious people within range of x,y (after exchange)
+    bool infectiousInRange(int x,int y,int range) const;
+    //heap bytes held by the counts and the exchanged infectious numbers
+    size_t bytes() const;
+private:
+    int index(int x,int y) const {return (x-_xlo)+(_xhi-_xlo)*(y-_ylo);}
+    //index into the whole grid, or -1 if off the grid (longitude wraps unless noLongitudeWrap)
+    int globalIndex(int x,int y) const;
+    int _xlo,_xhi,_ylo,_yhi;
+    int _minX,_maxX,_minY,_maxY;
+    bool _noLongitudeWrap;
+    double _infectionProb;
+    //people per count (simulation.AgentWeight)
+    double _weight;
+    std::vector<bool> _infectious;
+    std::vector<modes> _mode;
+    std::vector< std::vector<unsigned> > _infected;
+    std::vector< std::array<unsigned,SusceptiblePool::numberOfSexes> > _recovered;
+    std::vector<double> _globalInfectious;
+    //entries of _globalInfectious set by the last exchange - the rest are zero
+    std::vector<int> _filled;
+};
+#endif
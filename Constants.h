@@ -20,6 +20,14 @@ namespace Constants {
         eOther
     };
 
+    //realms of cells and agents - bit flags, so eAllRealms matches either
+    enum eRealms : unsigned char {
+        eNoRealm    = 0,
+        eTerrestrial= 1,
+        eMarine     = 2,
+        eAllRealms  = eTerrestrial | eMarine
+    };
+
     const std::string cLongitudeVariableNames[ ] = { "lon", "long", "longitude", "x" };
     const std::string cLatitudeVariableNames[ ] = { "lat", "lats", "latitude", "y" };
     const std::string cDepthVariableNames[ ] = { "dep", "depth", "z" };
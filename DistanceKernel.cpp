@@ -0,0 +1,86 @@
+/*
+ *
+ * DistanceKernel.cpp
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+#include <math.h>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "DistanceKernel.h"
+#include "Human.h"
+
+//------------------------------------------------------------------------------------------------------------
+void Candidates::push_back(Human* h){
+    _humans.push_back(h);
+    _x.push_back(h->_location[0]);
+    _y.push_back(h->_location[1]);
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned DistanceKernel::inRangeScalar(double x,double y,const double* xs,const double* ys,unsigned n,double width,bool wrap,unsigned* out){
+    unsigned k=0;
+    for (unsigned i=0;i<n;i++){
+        double dx=fabs(x-xs[i]);
+        if (wrap)dx=fmin(dx,width-dx);
+        double dy=fabs(y-ys[i]);
+        out[k]=i;
+        k+=(fmax(dx,dy)<1.);
+    }
+    return k;
+}
+//------------------------------------------------------------------------------------------------------------
+#if defined(__AVX512F__)
+unsigned DistanceKernel::inRange(double x,double y,const double* xs,const double* ys,unsigned n,double width,bool wrap,unsigned* out){
+    const __m512d vx=_mm512_set1_pd(x),vy=_mm512_set1_pd(y),vw=_mm512_set1_pd(width),one=_mm512_set1_pd(1.);
+    //eight doubles per register, so only the low eight of the sixteen index lanes are used
+    const __m512i step=_mm512_set1_epi32(8);
+    __m512i idx=_mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    unsigned k=0,i=0;
+    for (;i+8<=n;i+=8){
+        __m512d dx=_mm512_abs_pd(_mm512_sub_pd(vx,_mm512_loadu_pd(xs+i)));
+        if (wrap)dx=_mm512_min_pd(dx,_mm512_sub_pd(vw,dx));
+        __m512d dy=_mm512_abs_pd(_mm512_sub_pd(vy,_mm512_loadu_pd(ys+i)));
+        __mmask8 m=_mm512_cmp_pd_mask(_mm512_max_pd(dx,dy),one,_CMP_LT_OQ);
+        //write the indices of the lanes in range next to each other
+        _mm512_mask_compressstoreu_epi32(out+k,__mmask16(m),idx);
+        k+=_mm_popcnt_u32(m);
+        idx=_mm512_add_epi32(idx,step);
+    }
+    unsigned r=inRangeScalar(x,y,xs+i,ys+i,n-i,width,wrap,out+k);
+    for (unsigned j=k;j<k+r;j++)out[j]+=i;
+    return k+r;
+}
+const char* DistanceKernel::instructionSet(){return "AVX-512";}
+//------------------------------------------------------------------------------------------------------------
+#elif defined(__AVX2__)
+unsigned DistanceKernel::inRange(double x,double y,const double* xs,const double* ys,unsigned n,double width,bool wrap,unsigned* out){
+    //clearing the sign bit gives the absolute value
+    const __m256d sign=_mm256_set1_pd(-0.);
+    const __m256d vx=_mm256_set1_pd(x),vy=_mm256_set1_pd(y),vw=_mm256_set1_pd(width),one=_mm256_set1_pd(1.);
+    unsigned k=0,i=0;
+    for (;i+4<=n;i+=4){
+        __m256d dx=_mm256_andnot_pd(sign,_mm256_sub_pd(vx,_mm256_loadu_pd(xs+i)));
+        if (wrap)dx=_mm256_min_pd(dx,_mm256_sub_pd(vw,dx));
+        __m256d dy=_mm256_andnot_pd(sign,_mm256_sub_pd(vy,_mm256_loadu_pd(ys+i)));
+        int m=_mm256_movemask_pd(_mm256_cmp_pd(_mm256_max_pd(dx,dy),one,_CMP_LT_OQ));
+        //write the indices of the lanes in range next to each other
+        while (m){
+            int lane=__builtin_ctz(m);
+            out[k++]=i+lane;
+            m&=m-1;
+        }
+    }
+    unsigned r=inRangeScalar(x,y,xs+i,ys+i,n-i,width,wrap,out+k);
+    for (unsigned j=k;j<k+r;j++)out[j]+=i;
+    return k+r;
+}
+const char* DistanceKernel::instructionSet(){return "AVX2";}
+//------------------------------------------------------------------------------------------------------------
+#else
+unsigned DistanceKernel::inRange(double x,double y,const double* xs,const double* ys,unsigned n,double width,bool wrap,unsigned* out){
+    return inRangeScalar(x,y,xs,ys,n,width,wrap,out);
+}
+const char* DistanceKernel::instructionSet(){return "scalar";}
+#endif
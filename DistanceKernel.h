@@ -0,0 +1,39 @@
+/*
+ *
+ * DistanceKernel.h
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+
+#ifndef DISTANCEKERNEL_H
+#define DISTANCEKERNEL_H
+#include <vector>
+class Human;
+//------------------------------------------------------------------------------------------
+//Batched version of the distance test in Human::inDistance: one infector against a contiguous array of candidate co-ordinates.
+//A candidate is in range if the larger of its x and y separations (in cell widths, x wrapped round the globe unless noLongitudeWrap)
+//is less than one. The indices of candidates in range are written, in order, to the start of out (which needs room for n) and
+//the number in range is returned. Uses AVX-512 or AVX2 when the compiler targets them (e.g. -march=native), otherwise scalar code.
+//------------------------------------------------------------------------------------------
+namespace DistanceKernel {
+    unsigned inRange(double x,double y,const double* xs,const double* ys,unsigned n,double width,bool wrap,unsigned* out);
+    //plain loop, always available - used for the remainder of vector loops and for comparison in benchmarks
+    unsigned inRangeScalar(double x,double y,const double* xs,const double* ys,unsigned n,double width,bool wrap,unsigned* out);
+    //name of the instruction set used by inRange
+    const char* instructionSet();
+}
+//------------------------------------------------------------------------------------------
+//humans that might be infected, with their co-ordinates copied into contiguous arrays for the kernel
+struct Candidates {
+    std::vector<Human*> _humans;
+    std::vector<double> _x,_y;
+    //scratch space for the kernel output
+    std::vector<unsigned> _index;
+    void clear(){_humans.clear();_x.clear();_y.clear();}
+    void push_back(Human*);
+    //co-ordinates already to hand (e.g. from CellColumns) - the human is not dereferenced
+    void push_back(Human* h,double x,double y){_humans.push_back(h);_x.push_back(x);_y.push_back(y);}
+    unsigned size() const {return _humans.size();}
+};
+#endif
@@ -29,17 +29,17 @@ EnvironmentCell::EnvironmentCell(int x,int y):_x(x),_y(y){
 //------------------------------------------------------------------------------
 
 void EnvironmentCell::SetRealm( ) {
-    _Realm="none";
+    _Realm=Constants::eNoRealm;
     
     /*if( DataLayerSet::Data( )->GetDataAtLonLatFor( "Realm", Longitude(),  Latitude() ) <= 1.5 ) {
-          _Realm="marine";
+          _Realm=Constants::eMarine;
     } else if( DataLayerSet::Data( )->GetDataAtLonLatFor( "Realm", Longitude(),  Latitude() ) > 1.5) {
-          _Realm="terrestrial";
+          _Realm=Constants::eTerrestrial;
     }*/
     if( DataLayerSet::Data( )->GetDataAtLonLatFor( "Population", Longitude(),  Latitude() ) <= 0 ) {
-          _Realm="marine";
+          _Realm=Constants::eMarine;
     } else {
-          _Realm="terrestrial";
+          _Realm=Constants::eTerrestrial;
     }
 
 }
@@ -54,9 +54,9 @@ double EnvironmentCell::Temperature(){
 
  double d = 0;
  
- if( _Realm=="marine" ) {
+ if( _Realm==Constants::eMarine ) {
     d = GetVariableFromDatasetNamed("MarineTemp");
- } else if( _Realm=="terrestrial" ) {
+ } else if( _Realm==Constants::eTerrestrial ) {
     d = GetVariableFromDatasetNamed( "TerrestrialTemp");
  }
 
@@ -74,7 +74,7 @@ double EnvironmentCell::Population(){
 double EnvironmentCell::Precipitation(){
 
  double d = Constants::cMissingValue;//currently no marine precip
- if( _Realm=="terrestrial" ) {
+ if( _Realm==Constants::eTerrestrial ) {
    d = GetVariableFromDatasetNamed("TerrestrialPre");
   }
   return d;
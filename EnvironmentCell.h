@@ -19,7 +19,7 @@ public:
     void SetRealm( );
 
 
-    std::string _Realm;
+    Constants::eRealms _Realm;
 
 
 	virtual ~EnvironmentCell() {}
@@ -0,0 +1,77 @@
+/*
+ *
+ * ForceOfInfection.cpp
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+#include <math.h>
+#include <algorithm>
+#include "ForceOfInfection.h"
+#include "Human.h"
+#include "RandomStreams.h"
+
+ForceOfInfection::ForceOfInfection():_subCells(1),_x(0),_y(0),_width(1),_noLongitudeWrap(true),_weight(1),_active(false),_pressure(DiseaseRegistry::MaxDiseases){}
+//------------------------------------------------------------------------------------------------------------
+void ForceOfInfection::setup(unsigned subCells,int minX,int maxX,bool noLongitudeWrap,double weight){
+    _subCells=std::max(subCells,1u);
+    _weight=weight;
+    _width=maxX-minX+1;
+    _noLongitudeWrap=noLongitudeWrap;
+}
+//------------------------------------------------------------------------------------------------------------
+void ForceOfInfection::reset(int x,int y){
+    _x=x;_y=y;
+    _active=false;
+    for (auto& p:_pressure)p.clear();
+}
+//------------------------------------------------------------------------------------------------------------
+void ForceOfInfection::addSource(Human* h){
+    std::vector<InfectionSource> sources;
+    sourcesOf(h,sources);
+    for (auto& s:sources)addSource(s);
+}
+//------------------------------------------------------------------------------------------------------------
+void ForceOfInfection::sourcesOf(Human* h,std::vector<InfectionSource>& sources) const{
+    if (!h->_alive || !h->canInfect()) return;
+    for (unsigned id=0;id<DiseaseRegistry::size();id++){
+        disease& d=h->_diseases[id];
+        if (!d.present() || !d.infectious()) continue;
+        //a certain infection gets a pressure large enough that exp(-pressure) is zero
+        double p=d.infectionProb();
+        double contribution=_weight*((p<1.) ? -log(1.-p) : 1.e3);
+        if (contribution>0) sources.push_back({h->_location[0],h->_location[1],id,contribution});
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+void ForceOfInfection::addSource(const InfectionSource& s){
+    std::vector<double>& pressure=_pressure[s._disease];
+    if (pressure.empty()) pressure.resize(_subCells*_subCells,0.);
+    _active=true;
+    for (unsigned j=0;j<_subCells;j++){
+        double dy=fabs(s._y-(_y+(j+0.5)/_subCells));
+        if (dy>=1.) continue;
+        for (unsigned i=0;i<_subCells;i++){
+            double dx=fabs(s._x-(_x+(i+0.5)/_subCells));
+            if (!_noLongitudeWrap)dx=std::min(dx,_width-dx);
+            if (dx<1.) pressure[i+_subCells*j]+=s._contribution;
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+void ForceOfInfection::infect(Human* h){
+    if (!h->_alive) return;
+    unsigned s=subCellOf(h);
+    for (unsigned id=0;id<_pressure.size();id++){
+        std::vector<double>& pressure=_pressure[id];
+        if (!pressure.empty() && pressure[s]>0 && !h->hasDisease(id) && RandomStreams::uniform() < 1.-exp(-pressure[s]))h->infectWith(id);
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned ForceOfInfection::subCellOf(Human* h) const{
+    int i=int((h->_location[0]-_x)*_subCells);
+    int j=int((h->_location[1]-_y)*_subCells);
+    i=std::min(std::max(i,0),int(_subCells)-1);
+    j=std::min(std::max(j,0),int(_subCells)-1);
+    return i+_subCells*j;
+}
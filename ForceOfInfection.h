@@ -0,0 +1,60 @@
+/*
+ *
+ * ForceOfInfection.h
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+
+#ifndef FORCEOFINFECTION_H
+#define FORCEOFINFECTION_H
+#include <map>
+#include <string>
+#include <vector>
+
+class Human;
+//------------------------------------------------------------------------------------------
+//Alternative to the pairwise infection loop in Human::interact (selected with simulation.InteractionMode=forceOfInfection).
+//For one cell at a time, infectious humans deposit infection pressure -log(1-p) for each disease onto a lattice of sub-cells
+//(simulation.ForceOfInfectionSubCells per side, default 1), then each susceptible human makes one draw per disease against the pressure
+//in its sub-cell. The escape probability exp(-pressure) is the product of (1-p) over infectious humans in range, so this matches
+//the pairwise draws statistically while costing O(infectious + susceptible) rather than O(infectious x susceptible).
+//Sources are in range of a sub-cell if they are within one cell width (Manhattan style, as Human::inDistance) of its centre:
+//this is exact for range 0 (no cross-cell interaction), and approximates cross-cell interaction more closely as the number of sub-cells increases.
+//Pressure one infectious human puts out for one disease. These are copied out of the humans before an interaction pass,
+//so the pass reads no human that another thread may be infecting at the same time.
+//------------------------------------------------------------------------------------------
+struct InfectionSource {
+    double _x,_y;
+    unsigned _disease;
+    double _contribution;
+};
+//------------------------------------------------------------------------------------------
+class ForceOfInfection {
+public:
+    ForceOfInfection();
+    void setup(unsigned subCells,int minX,int maxX,bool noLongitudeWrap,double weight=1);
+    //clear pressures and set the cell being worked on
+    void reset(int x,int y);
+    //add pressure from an infectious human (any disease it is infectious with)
+    void addSource(Human*);
+    //append a source for each disease the human is infectious with (nothing if it cannot infect)
+    void sourcesOf(Human*,std::vector<InfectionSource>&) const;
+    void addSource(const InfectionSource&);
+    //true if any pressure has been added since the last reset
+    bool active() const {return _active;}
+    //one draw per disease with pressure at the human's location - the human is only infected with diseases it does not already have
+    void infect(Human*);
+private:
+    unsigned subCellOf(Human*) const;
+    unsigned _subCells;
+    int _x,_y;
+    int _width;
+    bool _noLongitudeWrap;
+    //people per human - each infectious human adds weight times the pressure
+    double _weight;
+    bool _active;
+    //indexed by DiseaseRegistry id - empty for diseases with no pressure
+    std::vector< std::vector<double> > _pressure;
+};
+#endif
@@ -0,0 +1,118 @@
+/*
+ *
+ * HaloExchange.cpp
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+#include <algorithm>
+#include "HaloExchange.h"
+#include "RankNeighbours.h"
+#include "CellIndex.h"
+#include "Human.h"
+
+//any tags below 32 will do (CompartmentCells::exchange uses those above). The lengths for each channel go with tag+countTags
+static const int packageTag=1,infectiousTag=2,countTags=16;
+
+HaloExchange::HaloExchange():_comm(MPI_COMM_NULL){}
+//------------------------------------------------------------------------------------------------------------
+void HaloExchange::setup(const RankNeighbours& neighbours,int xlo,int xhi,int ylo,int yhi,int halo){
+    _comm=neighbours.communicator();
+    int rank;
+    MPI_Comm_rank(_comm,&rank);
+    _ranks.clear();
+    for (auto r:neighbours.neighbours())if (r!=rank)_ranks.push_back(r);
+    _boundary.clear();_interior.clear();_destinations.clear();
+    for(int y = ylo; y < yhi; y++){
+        for(int x = xlo; x < xhi; x++){
+            //a cell is in the buffer zone of any other rank holding a cell within halo cells of it
+            std::vector<unsigned> to;
+            for (int i=-halo;i<=halo;i++){
+                for (int j=-halo;j<=halo;j++){
+                    int owner=neighbours.ownerOf(x+i,y+j);
+                    if (owner==rank) continue;
+                    unsigned k=std::find(_ranks.begin(),_ranks.end(),owner)-_ranks.begin();
+                    if (k<_ranks.size() && std::find(to.begin(),to.end(),k)==to.end())to.push_back(k);
+                }
+            }
+            if (to.empty())_interior.push_back({x,y});
+            else {_boundary.push_back({x,y});_destinations.push_back(to);}
+        }
+    }
+    _packages._send.assign(_ranks.size(),std::vector<AgentPackage>());
+    _infectious._send.assign(_ranks.size(),std::vector<InfectiousRecord>());
+}
+//------------------------------------------------------------------------------------------------------------
+void HaloExchange::start(CellIndex& cells,bool full){
+    for (auto& s:_packages._send)s.clear();
+    for (unsigned c=0;c<_boundary.size();c++){
+        for (auto a:*cells.cell(_boundary[c].first,_boundary[c].second)){
+            Human* h=(Human*)a;
+            if (!full && h->_dirty==0) continue;
+            AgentPackage package(h->getId());
+            h->PushThingsIntoPackage(package,full ? content::allFields : h->_dirty);
+            for (auto k:_destinations[c])_packages._send[k].push_back(package);
+        }
+    }
+    post(_packages,packageTag);
+}
+//------------------------------------------------------------------------------------------------------------
+const std::vector<AgentPackage>& HaloExchange::finish(){
+    collect(_packages);
+    return _packages._received;
+}
+//------------------------------------------------------------------------------------------------------------
+void HaloExchange::startInfectious(CellIndex& cells){
+    for (auto& s:_infectious._send)s.clear();
+    for (unsigned c=0;c<_boundary.size();c++){
+        int b=cells.index(_boundary[c].first,_boundary[c].second);
+        //most boundary cells have no one infectious - the cell columns say so without touching the humans
+        if (cells.infectious(b)==0) continue;
+        const CellColumns& columns=cells.columns(b);
+        std::vector<MadAgent*>& agents=cells.bucket(b);
+        for (unsigned k=0;k<agents.size();k++){
+            if (!columns.has(k,CellColumns::infectious)) continue;
+            InfectiousRecord record;
+            record._location=agents[k]->_location;
+            record._diseases=((Human*)agents[k])->infectiousDiseases();
+            if (record._diseases==0) continue;
+            for (auto r:_destinations[c])_infectious._send[r].push_back(record);
+        }
+    }
+    post(_infectious,infectiousTag);
+}
+//------------------------------------------------------------------------------------------------------------
+const std::vector<InfectiousRecord>& HaloExchange::finishInfectious(){
+    collect(_infectious);
+    return _infectious._received;
+}
+//------------------------------------------------------------------------------------------------------------
+template<class T>
+void HaloExchange::post(Channel<T>& c,int tag){
+    MPI_Datatype type=boost::mpi::get_mpi_datatype<T>(T());
+    unsigned n=_ranks.size();
+    c._sendCounts.resize(n);
+    c._receiveCounts.assign(n,0);
+    for (unsigned k=0;k<n;k++)c._sendCounts[k]=c._send[k].size();
+    //the lengths are a single int each, so they are sent straight away and waiting for them costs about one message latency
+    std::vector<MPI_Request> counts(2*n);
+    for (unsigned k=0;k<n;k++)MPI_Irecv(&c._receiveCounts[k],1,MPI_INT,_ranks[k],tag+countTags,_comm,&counts[k]);
+    for (unsigned k=0;k<n;k++)MPI_Isend(&c._sendCounts[k],1,MPI_INT,_ranks[k],tag+countTags,_comm,&counts[n+k]);
+    c._requests.resize(2*n);
+    for (unsigned k=0;k<n;k++)MPI_Isend(c._send[k].data(),c._send[k].size(),type,_ranks[k],tag,_comm,&c._requests[k]);
+    MPI_Waitall(counts.size(),counts.data(),MPI_STATUSES_IGNORE);
+    size_t total=0;
+    for (unsigned k=0;k<n;k++)total+=c._receiveCounts[k];
+    c._received.resize(total);
+    total=0;
+    for (unsigned k=0;k<n;k++){
+        MPI_Irecv(c._received.data()+total,c._receiveCounts[k],type,_ranks[k],tag,_comm,&c._requests[n+k]);
+        total+=c._receiveCounts[k];
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+template<class T>
+void HaloExchange::collect(Channel<T>& c){
+    MPI_Waitall(c._requests.size(),c._requests.data(),MPI_STATUSES_IGNORE);
+    c._requests.clear();
+}
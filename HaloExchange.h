@@ -0,0 +1,84 @@
+/*
+ *
+ * HaloExchange.h
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+
+#ifndef HALOEXCHANGE_H
+#define HALOEXCHANGE_H
+#include <utility>
+#include <vector>
+#include "AgentPackage.h"
+class CellIndex;
+class RankNeighbours;
+//------------------------------------------------------------------------------------------
+//What the interaction pass needs to know about an infectious human on another rank (sent with simulation.InfectiousHalo=true):
+//where it is and which diseases it is infectious with - 24 bytes (10 with quantised positions) rather than a whole AgentPackage.
+//------------------------------------------------------------------------------------------
+struct InfectiousRecord {
+    Coordinates _location;
+    //bit id set for each disease id, as Human::infectiousDiseases
+    uint8_t _diseases=0;
+    template<class Archive>
+    void serialize(Archive& ar, const unsigned int version) {
+        ar & _location;
+        ar & _diseases;
+    }
+};
+BOOST_IS_MPI_DATATYPE(InfectiousRecord)
+BOOST_IS_BITWISE_SERIALIZABLE(InfectiousRecord)
+BOOST_CLASS_IMPLEMENTATION(InfectiousRecord,object_serializable)
+BOOST_CLASS_TRACKING(InfectiousRecord,track_never)
+//------------------------------------------------------------------------------------------
+//Non-blocking update of buffer zone copies, used by MadModel::step in place of repast's synchronizeAgentStates
+//when simulation.OverlapHalo=true. Local cells are split into boundary cells (those in the buffer zone of another rank)
+//and interior cells: the model processes the boundary cells first, starts sending packages for the humans in them
+//to the neighbouring ranks, processes the interior cells while the messages are in flight, and only then waits for
+//the packages from its neighbours. Packages go over the Cartesian communicator in RankNeighbours as the AgentPackage MPI datatype.
+//Every neighbour is sent a message (possibly empty) each time, preceded by its length: once the lengths are in, start posts the
+//receives, so that large messages can move while the interior cells are processed rather than only once finish is called.
+//The buffer zone copies on another rank are those repast set up at the last sync, so packages for humans it does not hold
+//(e.g. ones born since) are ignored at the other end - they get copied at the next sync as usual.
+//The same boundary cells and destinations also serve a second, independent channel carrying only InfectiousRecords for the
+//infectious humans in them - enough for cross-cell interaction without repast making buffer zone copies at all.
+//------------------------------------------------------------------------------------------
+class HaloExchange {
+public:
+    HaloExchange();
+    //halo is the grid buffer width in cells
+    void setup(const RankNeighbours&,int xlo,int xhi,int ylo,int yhi,int halo);
+    const std::vector< std::pair<int,int> >& boundaryCells() const {return _boundary;}
+    const std::vector< std::pair<int,int> >& interiorCells() const {return _interior;}
+    //pack the humans in the boundary cells for the ranks that hold copies of them, and start sending -
+    //if full is false, only humans with changes (Human::_dirty) are sent, with only the changed fields
+    void start(CellIndex&,bool full);
+    //wait for all sends and receives to complete - returns the packages received from all neighbours
+    const std::vector<AgentPackage>& finish();
+    bool inFlight() const {return !_packages._requests.empty();}
+    //as start and finish, but records for the infectious humans in the boundary cells only
+    void startInfectious(CellIndex&);
+    const std::vector<InfectiousRecord>& finishInfectious();
+private:
+    //messages of one kind to and from each neighbour (indexed as _ranks) - the receives go into one buffer, one slice per neighbour
+    template<class T>
+    struct Channel {
+        std::vector< std::vector<T> > _send;
+        std::vector<int> _sendCounts,_receiveCounts;
+        std::vector<MPI_Request> _requests;
+        std::vector<T> _received;
+    };
+    template<class T>
+    void post(Channel<T>&,int tag);
+    template<class T>
+    void collect(Channel<T>&);
+    MPI_Comm _comm;
+    std::vector< std::pair<int,int> > _boundary,_interior;
+    //neighbouring ranks other than this one, and for each boundary cell the ones (as indices into _ranks) that hold copies of it
+    std::vector<int> _ranks;
+    std::vector< std::vector<unsigned> > _destinations;
+    Channel<AgentPackage> _packages;
+    Channel<InfectiousRecord> _infectious;
+};
+#endif
@@ -16,6 +16,8 @@
 #include "Parameters.h"
 #include "TimeStep.h"
 #include "UtilityFunctions.h"
+#include "RandomStreams.h"
+#include "DistanceKernel.h"
 #include "model.h"
 
 
@@ -34,7 +36,10 @@ using namespace repast;
     //_Accounting is shared by all cohorts - saves *a lot* of memory
     //only works as these are temporaries used only and completely within each call to step() by a cohort
     //NB do not reset within step() (e.g. by having newly reproduced cohorts call ResetAccounts() in setupOffspring() !)
-    std::map < std::string, std::map<std::string,double> > Human::_Accounting;
+    //one copy per thread, as humans on different threads step at the same time
+    thread_local Accounts Human::_Accounting;
+    //storage for all Humans on this rank
+    SlabPool Human::_Pool(sizeof(Human));
 //------------------------------------------------------------------------------------------------------------
 void Human::setParameters(repast::Properties* props){
     //shared constants - static function to read these from parameter file
@@ -44,30 +49,24 @@ void Human::setParameters(repast::Properties* props){
      _CellAreaToHectares                          = repast::strToDouble(props->getProperty("HumanParameters.CellAreaToHectares"));
 
 
+}
+//------------------------------------------------------------------------------------------------------------
+void* Human::operator new(size_t n){
+    //anything derived from Human and larger than it goes to the general heap
+    if (n>_Pool.blockSize()) return ::operator new(n);
+    return _Pool.allocate();
+}
+//------------------------------------------------------------------------------------------------------------
+void Human::operator delete(void* p,size_t n){
+    if (n>_Pool.blockSize()) ::operator delete(p);
+    else _Pool.release(p);
 }
 //------------------------------------------------------------------------------------------------------------
 void Human::ResetAccounts( ) {
-    // Initialize delta abundance sorted list with appropriate processes
-
-    _Accounting["abundance"]["mortality"] = 1.0;//NB this applies because of a change from the original model - this value is now a multiplier (reduces possibility of negatives)
-
-    // Initialize delta biomass sorted list with appropriate processes
-    _Accounting["biomass"]["metabolism"] = 0.0;
-    _Accounting["biomass"]["carnivory"] = 0.0;
-    _Accounting["biomass"]["herbivory"] = 0.0;
-    _Accounting["biomass"]["reproduction"] = 0.0;
-
-    // Initialize delta reproductive biomass vector with appropriate processes
-
-    _Accounting["reproductivebiomass"]["reproduction"] = 0.0;
-
-    // Initialize organic pool delta vector with appropriate processes
-    _Accounting["organicpool"]["herbivory"] = 0.0;
-    _Accounting["organicpool"]["carnivory"] = 0.0;
-    _Accounting["organicpool"]["mortality"] = 0.0;
-
-    // Initialize respiratory CO2 pool delta vector with appropriate processes
-    _Accounting["respiratoryCO2pool"]["metabolism"] = 0.0;
+    //abundance mortality is a multiplier (a change from the original model - reduces possibility of negatives)
+    //biomass (metabolism, carnivory, herbivory, reproduction), reproductive biomass (reproduction),
+    //organic pool (herbivory, carnivory, mortality) and respiratory CO2 pool (metabolism) deltas all start at zero
+    _Accounting.reset();
 }
 //used to create an initial set of cohorts at the start of a run
 //------------------------------------------------------------------------------------------------------------
@@ -78,7 +77,7 @@ void Human::setup(unsigned functionalGroup,unsigned numHumansThisCell,Environmen
 
     _alive = true;
     _moved=false;
-    _location={0,0};
+    _location=Coordinates(0,0);
     _IsMature=true;
 
     setPropertiesFromCohortDefinitions(_FunctionalGroupIndex);
@@ -96,55 +95,62 @@ void Human::setup(unsigned functionalGroup,unsigned numHumansThisCell,Environmen
 //------------------------------------------------------------------------------------------------------------
 void Human::setPropertiesFromCohortDefinitions(unsigned functionalGroup){
 
-    _Realm      ="terrestrial";
+    _Realm      =Constants::eTerrestrial;
 
     //_MinimumMass=CohortDefinitions::Get()->Property(functionalGroup   ,"minimum mass");could read indiv mass from a file
     //_MaximumMass=CohortDefinitions::Get()->Property(functionalGroup   ,"maximum mass");
 }
 //------------------------------------------------------------------------------------------------------------
 //Required by RHPC for cross-core copy - NB "Accounts" do not need to be included as they are instantaneous within a timestep
+//only the groups of fields carried by the package are copied (all of them, except in ghost updates)
 void Human::PullThingsOutofPackage( const AgentPackage& package ) {
+    const content& c=package._contents;
+    if (c._fields & content::otherFields){
+        _sequencer                   = c._sequencer;
+        _FunctionalGroupIndex        = c._FunctionalGroupIndex;
 
-    _sequencer                   = package._contents._sequencer;
-    _FunctionalGroupIndex        = package._contents._FunctionalGroupIndex;
-
-    _IndividualBodyMass          = package._contents._IndividualBodyMass;
-    _BirthTimeStep               = package._contents._BirthTimeStep;
-    _MaturityTimeStep            = package._contents._MaturityTimeStep;
+        _IndividualBodyMass          = c._IndividualBodyMass;
+        _BirthTimeStep               = c._BirthTimeStep;
+        _MaturityTimeStep            = c._MaturityTimeStep;
 
-    _alive                       = package._contents._alive;
-
-    setPropertiesFromCohortDefinitions(_FunctionalGroupIndex);
+        setPropertiesFromCohortDefinitions(_FunctionalGroupIndex);
   
-    _IsMature=package._contents._IsMature;
+        _IsMature=c._IsMature;
     
-    _moved=package._contents._moved;
-    _location=package._contents._location;
-    _destination=package._contents._destination;
-    _sex=package._contents._sex;
-    _diseases=package._contents._diseases;
+        _moved=c._moved;
+        _sex=c._sex;
+    }
+    if (c._fields & content::aliveField)    _alive = c._alive;
+    if (c._fields & content::diseaseFields) std::copy(c._diseases,c._diseases+DiseaseRegistry::MaxDiseases,_diseases.begin());
+    if (c._fields & content::locationFields){
+        _location=c._location;
+        _destination=c._destination;
+    }
 }
 //------------------------------------------------------------------------------------------------------------
 //Required by RHPC for cross-core copy
-void Human::PushThingsIntoPackage( AgentPackage& package ) {
-    package._contents._sequencer                   =  _sequencer;
-    package._contents._FunctionalGroupIndex        =  _FunctionalGroupIndex;
-
-    package._contents._IndividualBodyMass          =  _IndividualBodyMass;
-    package._contents._BirthTimeStep               =  _BirthTimeStep;
-    package._contents._MaturityTimeStep            =  _MaturityTimeStep;
-
-    package._contents._alive                       =  _alive;
- 
+void Human::PushThingsIntoPackage( AgentPackage& package,unsigned char fields ) {
+    content& c=package._contents;
+    c._fields=fields;
+    if (fields & content::otherFields){
+        c._sequencer                   =  _sequencer;
+        c._FunctionalGroupIndex        =  _FunctionalGroupIndex;
+
+        c._IndividualBodyMass          =  _IndividualBodyMass;
+        c._BirthTimeStep               =  _BirthTimeStep;
+        c._MaturityTimeStep            =  _MaturityTimeStep;
    
-    package._contents._IsMature= _IsMature;
-    
-    package._contents._moved=_moved;
-    package._contents._location=_location;
-    package._contents._destination=_destination;
-    package._contents._sex=_sex;
-    package._contents._diseases=_diseases;
+        c._IsMature= _IsMature;
     
+        c._moved=_moved;
+        c._sex=_sex;
+    }
+    if (fields & content::aliveField)    c._alive=_alive;
+    if (fields & content::diseaseFields) std::copy(_diseases.begin(),_diseases.end(),c._diseases);
+    if (fields & content::locationFields){
+        c._location=_location;
+        c._destination=_destination;
+    }
 }
 //------------------------------------------------------------------------------------------------------------
 void Human::setupOffspring( Human* actingHuman, double juvenileBodyMass, double adultBodyMass, double initialBodyMass, double initialAbundance, unsigned birthTimeStep ) {
@@ -171,16 +177,15 @@ void Human::setupOffspring( Human* actingHuman, double juvenileBodyMass, double
 
 }
 //------------------------------------------------------------------------------------------------------------
-void Human::step(vector<Human*>& others,const unsigned Timestep,MadModel* m) {
+//interaction with other humans is done separately, see MadModel::step
+void Human::step(const unsigned Timestep,MadModel* m) {
     _newH=NULL;//make sure the reproduction pointer has been zeroed out
 
 
     _CurrentTimeStep=Timestep;
 
     ResetAccounts( );
-    for (auto A: _Accounting)for (auto B: A.second)if(B.first!="mortality")assert(B.second==0);
 
-    if (m->_interacting )interact(others,m);
     if (m->_metabolism  )metabolize();
     if (m->_reproduction)reproduce();
     if (m->_death       )mort();
@@ -189,32 +194,109 @@ void Human::step(vector<Human*>& others,const unsigned Timestep,MadModel* m) {
 }
 //------------------------------------------------------------------------------------------------------------
 void Human::interact(vector<Human*>& others,MadModel* m){
-    if (!hasDisease("covid") || recoveredFrom("covid")) return;
+    if (!canInfect()) return;
+    Candidates candidates;
+    for (auto& agent: others)candidates.push_back(agent);
+    interact(candidates,m);
+}
+//------------------------------------------------------------------------------------------------------------
+void Human::interact(Candidates& others,MadModel* m){
+    if (!canInfect()) return;
     double _DaysInATimeStep=TimeStep::instance()->DaysPerTimeStep();
     
-    
-    // Loop over potential prey functional groups
-    for (auto& agent: others){
-        if (inDistance(this,agent,m)){
-           for (auto& [name,d]:_diseases){if (d.infectious() && !agent->hasDisease(name) && repast::Random::instance()->nextDouble() < d.infectionProb())agent->infectWith(name);} 
-        }
+    //candidates in range are found once (the batched equivalent of inDistance), then each disease makes its trials over them
+    others._index.resize(others.size());
+    unsigned n=DistanceKernel::inRange(_location[0],_location[1],others._x.data(),others._y.data(),others.size(),
+                                       m->_maxX - m->_minX+1,!m->_noLongitudeWrap,others._index.data());
+    if (n==0) return;
+    vector<Human*> inRange(n);
+    for (unsigned i=0;i<n;i++)inRange[i]=others._humans[others._index[i]];
+
+    vector<Human*> candidates;
+    for (unsigned id=0;id<DiseaseRegistry::size();id++){
+        disease& d=_diseases[id];
+        if (!d.present() || !d.infectious()) continue;
+        //with weighted agents each human stands for weight people, so a susceptible faces weight draws of p
+        double p=weightedProb(d.infectionProb(),m->_agentWeight);
+        if (p<=0) continue;
+        candidates.clear();
+        for (auto& agent:inRange)if (!agent->hasDisease(id))candidates.push_back(agent);
+        if (p>=1){for (auto& agent:candidates)agent->infectWith(id);continue;}
+        //the same independent trial with probability p for every candidate as one draw each, but jumping straight
+        //to the next success with a geometric gap - one random number per infection rather than one per pair
+        double logq=log(1.-p);
+        for (double i=RandomStreams::skip(logq);i<candidates.size();i+=RandomStreams::skip(logq)+1)candidates[size_t(i)]->infectWith(id);
     }
 }
 //------------------------------------------------------------------------------------------------------------
+double Human::weightedProb(double p,double weight){
+    if (weight==1) return p;
+    return 1.-pow(1.-p,weight);
+}
+//------------------------------------------------------------------------------------------------------------
 void Human::infectWith(std::string name){
-    _diseases[name].infect();
+    infectWith(DiseaseRegistry::id(name));
 }
 //------------------------------------------------------------------------------------------------------------
 bool Human::hasDisease(std::string name){
-    return (_diseases.find(name)!=_diseases.end());
+    unsigned id=DiseaseRegistry::find(name);
+    return id!=DiseaseRegistry::NoDisease && hasDisease(id);
 }
 //------------------------------------------------------------------------------------------------------------
-void Human::updateDiseases(){
-    for (auto& [name,d]:_diseases)d.update();
+bool Human::recoveredFrom(std::string name){
+    unsigned id=DiseaseRegistry::find(name);
+    return id!=DiseaseRegistry::NoDisease && recoveredFrom(id);
 }
 //------------------------------------------------------------------------------------------------------------
-bool Human::recoveredFrom(std::string name){
-    return _diseases[name].recovered();
+disease& Human::diseaseState(std::string name){
+    return diseaseState(DiseaseRegistry::id(name));
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned Human::numberOfDiseases(){
+    unsigned n=0;
+    for (auto& d:_diseases)if (d.present())n++;
+    return n;
+}
+//------------------------------------------------------------------------------------------------------------
+void Human::clearDiseases(){
+    for (unsigned id=0;id<_diseases.size();id++)_diseases[id]=disease(id);
+}
+//------------------------------------------------------------------------------------------------------------
+//only humans carrying covid (and not yet recovered) pass on infections
+bool Human::canInfect(){
+    return hasDisease(DiseaseRegistry::covid) && !recoveredFrom(DiseaseRegistry::covid);
+}
+//------------------------------------------------------------------------------------------------------------
+//true if this human could infect others at the moment
+bool Human::isInfectious(){
+    if (!canInfect()) return false;
+    for (unsigned id=0;id<DiseaseRegistry::size();id++)if (_diseases[id].present() && _diseases[id].infectious())return true;
+    return false;
+}
+//------------------------------------------------------------------------------------------------------------
+uint8_t Human::infectiousDiseases(){
+    if (!_alive || !canInfect()) return 0;
+    uint8_t bits=0;
+    for (unsigned id=0;id<DiseaseRegistry::size();id++)if (_diseases[id].present() && _diseases[id].infectious())bits|=uint8_t(1)<<id;
+    return bits;
+}
+//------------------------------------------------------------------------------------------------------------
+//the stand-in only needs what interaction looks at: it is alive, at the given location, can infect (carries covid, not recovered)
+//and is infectious with exactly the given diseases - infection probabilities come from DiseaseRegistry
+void Human::standInFor(const Coordinates& location,uint8_t infectiousDiseases){
+    _alive=true;
+    _location=location;
+    clearDiseases();
+    _diseases[DiseaseRegistry::covid].infect();
+    for (unsigned id=0;id<DiseaseRegistry::size();id++){
+        if ((infectiousDiseases>>id)&1){_diseases[id].infect();_diseases[id].becomeInfectious();}
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+void Human::updateDiseases(){
+    //only a change of stage is worth sending to buffer zone copies - they never update their own diseases, so a stale timer
+    //there is harmless, and a human that migrates is always sent in full
+    for (unsigned id=0;id<DiseaseRegistry::size();id++)if (_diseases[id].present() && _diseases[id].update())_dirty|=content::diseaseFields;
 }
 //------------------------------------------------------------------------------------------------------------
 void Human::markForDeath(){
@@ -222,6 +304,7 @@ void Human::markForDeath(){
 
       //mark the cohort but don't kill it yet to avoid any problems with movement code in parallel (or there may be disease spread after death)
       _alive=false;
+      _dirty|=content::aliveField;
     }
 }
 //------------------------------------------------------------------------------------------------------------
@@ -238,12 +321,13 @@ void Human::moveIt(EnvironmentCell* e,MadModel* m){
         TryToDisperse( dispersalSpeed,e,m );
 
         //all cohorts need to update their current position
+        if (_destination[0]!=_location[0] || _destination[1]!=_location[1])_dirty|=content::locationFields;
         _location=_destination;
       
 }
 //------------------------------------------------------------------------------------------------------------
 void Human::TryToDisperse(double dispersalSpeed, EnvironmentCell* e,MadModel* m){
-    double randomDirection = repast::Random::instance()->nextDouble()* 2 * _Pi;
+    double randomDirection = RandomStreams::uniform()* 2 * _Pi;
 
     // Calculate the u and v components given the dispersal speed
     double uSpeed = dispersalSpeed * cos( randomDirection );
@@ -253,7 +337,7 @@ void Human::TryToDisperse(double dispersalSpeed, EnvironmentCell* e,MadModel* m)
   //------------------------------------------------------------------------------------------------------------
 void Human::TryToDisperse(double uSpeed, double vSpeed,EnvironmentCell* e, MadModel* m){
 
-      vector<double> uv={0,0};//default to no dispersal
+      Coordinates uv(0,0);//default to no dispersal
       if (m->_dispersalSelection=="direct"       ) uv=dDirect(uSpeed,vSpeed,e);
       
       double signu=uv[0];
@@ -272,16 +356,15 @@ void Human::TryToDisperse(double uSpeed, double vSpeed,EnvironmentCell* e, MadMo
      int xw=floor(x+signu);
      if (yw >= m->_minY && yw <= m->_maxY){
          if (xw >= m->_minX && xw <= m->_maxX) {
-             EnvironmentCell* E=m->_Env[xw][yw];
-             if (E->_Realm==_Realm || _Realm=="all"){// no movement if wrong realm at destination
-               _destination[0]=x+signu;_destination[1]=y+signv;
+             if (m->_land.allows(_Realm,xw,yw)){// no movement if wrong realm at destination
+               _destination=Coordinates(x+signu,y+signv);
                if (xw!=floor(_location[0]) || yw!=floor(_location[1]))_moved=true;//special treatment needed if we have changed cell
            }          
          }
      } 
    }
 //------------------------------------------------------------------------------------------------------------
- vector<double> Human::dDirect(double uSpeed, double vSpeed,EnvironmentCell* e){
+ Coordinates Human::dDirect(double uSpeed, double vSpeed,EnvironmentCell* e){
     //dispersal where cohorts can take on fractional cell co-ordinates
     //this is *required* when cross-cell interaction becomes important
     // Calculate the fraction of the grid cell in the u direction 
@@ -289,7 +372,7 @@ void Human::TryToDisperse(double uSpeed, double vSpeed,EnvironmentCell* e, MadMo
 
     // Calculate the fraction of the grid cell in the v direction
     double vfrac = ( vSpeed / e->Height() );
-    return vector<double>({ufrac,vfrac});
+    return Coordinates(ufrac,vfrac);
  }
 //------------------------------------------------------------------------------------------------------------
 bool Human::inDistance(MadAgent* a1, MadAgent* a2,MadModel* m){
@@ -10,6 +10,8 @@
 
 #ifndef HUMAN_H_
 #define HUMAN_H_
+#include <array>
+#include <cstring>
 #include "agent.h"
 #include "repast_hpc/AgentId.h"
 #include "repast_hpc/SharedContext.h"
@@ -21,8 +23,22 @@
 #include "EnvironmentCell.h"
 #include "randomizer.h"
 #include "disease.h"
+#include "SlabPool.h"
 
 class MadModel;
+struct Candidates;
+//------------------------------------------------------------------------------------------
+//within-timestep changes made by a human's ecological processes, indexed by quantity and process
+//plain array of doubles, so a reset is one memset rather than a rebuild of string-keyed maps
+//------------------------------------------------------------------------------------------
+struct Accounts{
+    enum quantities{abundance,biomass,reproductiveBiomass,organicPool,respiratoryCO2Pool,numberOfQuantities};
+    enum processes {mortality,metabolism,carnivory,herbivory,reproduction,numberOfProcesses};
+    double _delta[numberOfQuantities][numberOfProcesses];
+    double& operator()(quantities q,processes p){return _delta[q][p];}
+    //abundance mortality is a multiplier, so starts at 1 - everything else starts at zero
+    void reset(){memset(_delta,0,sizeof(_delta));_delta[abundance][mortality]=1.0;}
+};
 
 class Human: public MadAgent  {
 
@@ -36,7 +52,7 @@ public:
     unsigned _BirthTimeStep;            
     unsigned _MaturityTimeStep;            
     
-    std::string _Realm;      
+    Constants::eRealms _Realm;
    
     char _sex;
     
@@ -52,26 +68,37 @@ public:
     static double _CellAreaToHectares;
     
     //temporary store for within timestep changes
-    static std::map < std::string, std::map<std::string,double> > _Accounting;
+    static thread_local Accounts _Accounting;
 
 public:
 
-    map<string,disease>_diseases;
+    //indexed by DiseaseRegistry id - only entries with present() set are carried by this human
+    std::array<disease,DiseaseRegistry::MaxDiseases> _diseases;
     static unsigned _NextID;
     Human* _newH;
-    Human(repast::AgentId id): MadAgent(id){_NextID++;_newH=NULL;_sequencer=0;}
+    //content::fieldGroups changed since the last ghost update was sent - see MadAgentPackageProvider::provideContent
+    unsigned char _dirty;
+    Human(repast::AgentId id): MadAgent(id){_NextID++;_newH=NULL;_sequencer=0;_dirty=content::allFields;clearDiseases();}
     //for copy across threads (needs increaseNextID=false) or restore from file (set increaseNextID to true)
-	Human(repast::AgentId id, const AgentPackage& package,bool increaseNextID=false): MadAgent(id){PullThingsOutofPackage(package);_newH=NULL;if (increaseNextID)_NextID++;_sequencer=0;}
+	Human(repast::AgentId id, const AgentPackage& package,bool increaseNextID=false): MadAgent(id){PullThingsOutofPackage(package);_newH=NULL;if (increaseNextID)_NextID++;_sequencer=0;_dirty=content::allFields;}
     void set(int currentRank, const AgentPackage& package){_id.currentRank(currentRank);PullThingsOutofPackage(package);}
 	void setup(unsigned,unsigned,EnvironmentCell*,randomizer*);
     void setPropertiesFromCohortDefinitions(unsigned);
 	virtual ~Human() {}
+    //all humans (init, births, migrants, ghost copies, restarts) come from one slab pool per rank - blocks freed by
+    //removeAgent (via the context's shared_ptr) go back on the pool's free list for reuse
+    static SlabPool _Pool;
+    static void* operator new(size_t);
+    static void  operator delete(void*,size_t);
 
-	void step(vector<Human*>&,const unsigned,MadModel*);
+	void step(const unsigned,MadModel*);
 
     void metabolize();
     void reproduce();
     void interact(vector<Human*>&,MadModel*);
+    void interact(Candidates&,MadModel*);
+    //chance of infection from one contact when each human stands for weight people
+    static double weightedProb(double p,double weight);
     void moveIt(EnvironmentCell*,MadModel*);
     void mort();
     void markForDeath();
@@ -79,14 +106,30 @@ public:
     void setupOffspring( Human* , double , double , double , double , unsigned  );
     void TryToDisperse(double,EnvironmentCell*,MadModel* );
     void TryToDisperse(double,double,EnvironmentCell*,MadModel*);
-    vector<double> dDirect(double,double,EnvironmentCell*);
+    Coordinates dDirect(double,double,EnvironmentCell*);
     bool inDistance(MadAgent*, MadAgent*,MadModel *);
-    void PushThingsIntoPackage( AgentPackage& );
+    void PushThingsIntoPackage( AgentPackage&,unsigned char fields=content::allFields );
     void PullThingsOutofPackage( const AgentPackage& );
     void ResetAccounts();
+    //disease state by registry id - these are the ones to use in loops over agents
+    void infectWith(unsigned id){_diseases[id].infect();_dirty|=content::diseaseFields;}
+    bool hasDisease(unsigned id){return _diseases[id].present();}
+    bool recoveredFrom(unsigned id){return _diseases[id].recovered();}
+    //the disease entry, which this human now carries (whether infected or not)
+    disease& diseaseState(unsigned id){_diseases[id].setPresent();_dirty|=content::diseaseFields;return _diseases[id];}
+    unsigned numberOfDiseases();
+    void clearDiseases();
+    //by name - these look up the registry each time
     void infectWith(std::string);
     bool hasDisease(std::string);
     bool recoveredFrom(std::string);
+    disease& diseaseState(std::string);
+    bool canInfect();
+    bool isInfectious();
+    //bit id set for each disease id this (living) human could pass on at the moment - 0 if none
+    uint8_t infectiousDiseases();
+    //make this human a stand-in, at location, for an infectious human on another rank (see HaloExchange::startInfectious)
+    void standInFor(const Coordinates& location,uint8_t infectiousDiseases);
     void updateDiseases();
 };
 #endif /* HUMAN_H_ */
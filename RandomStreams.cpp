@@ -0,0 +1,62 @@
+/*
+ *
+ * RandomStreams.cpp
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <math.h>
+#include "repast_hpc/Random.h"
+#include "RandomStreams.h"
+
+unsigned RandomStreams::_threads=1;
+std::vector<std::mt19937_64> RandomStreams::_streams;
+//------------------------------------------------------------------------------------------------------------
+void RandomStreams::Initialise(unsigned seed,int rank,unsigned threads){
+    _threads=std::max(threads,1u);
+#ifdef _OPENMP
+    omp_set_num_threads(_threads);
+#else
+    _threads=1;
+#endif
+    _streams.clear();
+    for (unsigned t=0;t<_threads;t++){
+        std::seed_seq s{seed,unsigned(rank),t};
+        _streams.push_back(std::mt19937_64(s));
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned RandomStreams::threadNumber(){
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+//------------------------------------------------------------------------------------------------------------
+double RandomStreams::uniform(){
+    if (_threads==1) return repast::Random::instance()->nextDouble();
+    //top 53 bits of the 64 bit draw - always strictly less than 1
+    return (_streams[threadNumber()]()>>11)*(1.0/9007199254740992.0);
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned RandomStreams::binomial(unsigned n,double p){
+    if (n==0 || p<=0) return 0;
+    if (p>=1) return n;
+    //jump from one success to the next with geometric gaps - one draw per success rather than one per trial
+    double logq=log(1.-p);
+    unsigned k=0;
+    double i=skip(logq);
+    while (i<n){
+        k++;
+        i+=skip(logq)+1;
+    }
+    return k;
+}
+//------------------------------------------------------------------------------------------------------------
+double RandomStreams::skip(double logq){
+    return floor(log(1.-uniform())/logq);
+}
@@ -0,0 +1,34 @@
+/*
+ *
+ * RandomStreams.h
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+
+#ifndef RANDOMSTREAMS_H
+#define RANDOMSTREAMS_H
+#include <random>
+#include <vector>
+//------------------------------------------------------------------------------------------
+//Random numbers for code that may run on more than one thread within an MPI rank (see simulation.Threads).
+//repast::Random is a single shared generator, so with threads each one gets its own stream, seeded from global.random.seed,
+//the rank and the thread number. With one thread draws still come from repast::Random, so single-threaded runs are unchanged.
+//------------------------------------------------------------------------------------------
+class RandomStreams {
+public:
+    static void Initialise(unsigned seed,int rank,unsigned threads);
+    static unsigned threads(){return _threads;}
+    //number of the calling thread (0 outside parallel regions or without OpenMP)
+    static unsigned threadNumber();
+    //uniform on [0,1)
+    static double uniform();
+    //number of successes in n trials with probability p each
+    static unsigned binomial(unsigned n,double p);
+    //number of failures before the next success in trials with probability p each - logq is log(1-p), with 0<p<1
+    static double skip(double logq);
+private:
+    static unsigned _threads;
+    static std::vector<std::mt19937_64> _streams;
+};
+#endif
@@ -0,0 +1,49 @@
+/*
+ *
+ * RankNeighbours.cpp
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+#include <algorithm>
+#include "RankNeighbours.h"
+
+RankNeighbours::RankNeighbours():_cart(MPI_COMM_NULL),_minX(0),_minY(0),_width(1),_height(1),_cellsX(1),_cellsY(1){_dims[0]=1;_dims[1]=1;}
+//------------------------------------------------------------------------------------------------------------
+RankNeighbours::~RankNeighbours(){
+    int finalized=0;
+    MPI_Finalized(&finalized);
+    if (_cart!=MPI_COMM_NULL && !finalized)MPI_Comm_free(&_cart);
+}
+//------------------------------------------------------------------------------------------------------------
+void RankNeighbours::setup(int dimX,int dimY,int xlo,int xhi,int ylo,int yhi,int minX,int maxX,int minY,int maxY){
+    _dims[0]=dimX;_dims[1]=dimY;
+    _minX=minX;_minY=minY;
+    _width =maxX-minX+1;
+    _height=maxY-minY+1;
+    _cellsX=std::max(xhi-xlo,1);
+    _cellsY=std::max(yhi-ylo,1);
+    if (_cart!=MPI_COMM_NULL)MPI_Comm_free(&_cart);
+    //no reordering, so ranks here are the same as in MPI_COMM_WORLD (and repast's own Cartesian layout)
+    int periods[2]={1,1};
+    MPI_Cart_create(MPI_COMM_WORLD,2,_dims,periods,0,&_cart);
+    int rank,coords[2];
+    MPI_Comm_rank(_cart,&rank);
+    MPI_Cart_coords(_cart,rank,2,coords);
+    _neighbours.clear();
+    for (int i=-1;i<=1;i++){
+        for (int j=-1;j<=1;j++){
+            int c[2]={coords[0]+i,coords[1]+j},r;
+            MPI_Cart_rank(_cart,c,&r);
+            _neighbours.insert(r);
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+int RankNeighbours::ownerOf(int x,int y) const{
+    int xw=(x-_minX)%_width; if (xw<0)xw+=_width;
+    int yw=(y-_minY)%_height;if (yw<0)yw+=_height;
+    int c[2]={std::min(xw/_cellsX,_dims[0]-1),std::min(yw/_cellsY,_dims[1]-1)},r;
+    MPI_Cart_rank(_cart,c,&r);
+    return r;
+}
@@ -0,0 +1,39 @@
+/*
+ *
+ * RankNeighbours.h
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+
+#ifndef RANKNEIGHBOURS_H
+#define RANKNEIGHBOURS_H
+#include <mpi.h>
+#include <set>
+//------------------------------------------------------------------------------------------
+//The layout of MPI ranks over the grid (proc.per.x by proc.per.y, periodic in both directions as the repast space wraps),
+//held as an MPI Cartesian communicator with the same rank numbering as MPI_COMM_WORLD - so that the model can tell whether
+//an agent leaving this rank is going to one of the (up to) 8 neighbouring ranks, which is all RepastProcess::USE_CURRENT exchanges with.
+//Assumes the grid is split evenly between ranks, as repast does.
+//------------------------------------------------------------------------------------------
+class RankNeighbours {
+public:
+    RankNeighbours();
+    ~RankNeighbours();
+    //xlo,xhi,ylo,yhi are the local grid extents on this rank
+    void setup(int dimX,int dimY,int xlo,int xhi,int ylo,int yhi,int minX,int maxX,int minY,int maxY);
+    //rank holding grid cell x,y (wrapped as for the repast space)
+    int ownerOf(int x,int y) const;
+    //true if cell x,y is held by this rank or one of its neighbours
+    bool isNeighbour(int x,int y) const {return _neighbours.count(ownerOf(x,y))>0;}
+    //neighbouring ranks, including this one - fewer than 9 if there are fewer than 3 ranks in a direction
+    const std::set<int>& neighbours() const {return _neighbours;}
+    //same ranks as MPI_COMM_WORLD, but separate from repast's messages
+    MPI_Comm communicator() const {return _cart;}
+private:
+    MPI_Comm _cart;
+    int _dims[2];
+    int _minX,_minY,_width,_height,_cellsX,_cellsY;
+    std::set<int> _neighbours;
+};
+#endif
@@ -0,0 +1,46 @@
+/*
+ *
+ * RealmMask.cpp
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+#include "RealmMask.h"
+#include "Environment.h"
+
+RealmMask::RealmMask():_bx0(0),_by0(0),_nx(0),_ny(0),_minX(0),_minY(0),_width(1),_height(1),_env(NULL){}
+//------------------------------------------------------------------------------------------------------------
+void RealmMask::setup(int xlo,int xhi,int ylo,int yhi,int halo,int minX,int maxX,int minY,int maxY,Environment& env){
+    _env=&env;
+    _minX=minX;_minY=minY;
+    _width =maxX-minX+1;
+    _height=maxY-minY+1;
+    //as CellIndex - no halo in a direction where the local grid already covers everything
+    int hx=halo,hy=halo;
+    if (xhi-xlo+2*hx>_width ) hx=0;
+    if (yhi-ylo+2*hy>_height) hy=0;
+    _bx0=xlo-hx;_nx=xhi-xlo+2*hx;
+    _by0=ylo-hy;_ny=yhi-ylo+2*hy;
+    _bits.assign((_nx*_ny+63)/64,0);
+    for (int j=0;j<_ny;j++){
+        for (int i=0;i<_nx;i++){
+            int x=(_bx0+i-_minX+_width)%_width+_minX,y=(_by0+j-_minY+_height)%_height+_minY;
+            if (env[x][y]->_Realm==Constants::eTerrestrial){
+                int n=i+_nx*j;
+                _bits[n/64]|=uint64_t(1)<<(n%64);
+            }
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+bool RealmMask::isLand(int x,int y) const{
+    int dx=(x-_bx0)%_width;  if (dx<0)dx+=_width;
+    int dy=(y-_by0)%_height; if (dy<0)dy+=_height;
+    if (dx>=_nx || dy>=_ny){
+        int xw=(x-_minX)%_width; if (xw<0)xw+=_width;
+        int yw=(y-_minY)%_height;if (yw<0)yw+=_height;
+        return (*_env)[xw+_minX][yw+_minY]->_Realm==Constants::eTerrestrial;
+    }
+    int n=dx+_nx*dy;
+    return (_bits[n/64]>>(n%64))&1;
+}
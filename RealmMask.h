@@ -0,0 +1,36 @@
+/*
+ *
+ * RealmMask.h
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+
+#ifndef REALMMASK_H
+#define REALMMASK_H
+#include <cstdint>
+#include <vector>
+#include "Constants.h"
+class Environment;
+//------------------------------------------------------------------------------------------
+//One bit per cell, set for land (terrestrial) cells, covering the local part of the grid plus a halo of cells around it
+//(wrapped as for the repast space) - so the realm check on every dispersal step is a bit test rather than
+//an EnvironmentCell lookup. Cells outside the box (only reached by long moves) are looked up in the Environment.
+//------------------------------------------------------------------------------------------
+class RealmMask {
+public:
+    RealmMask();
+    void setup(int xlo,int xhi,int ylo,int yhi,int halo,int minX,int maxX,int minY,int maxY,Environment&);
+    bool isLand(int x,int y) const;
+    //true if an agent of the given realm can be in cell x,y
+    bool allows(Constants::eRealms realm,int x,int y) const{
+        if (realm==Constants::eAllRealms) return true;
+        return (realm & (isLand(x,y) ? Constants::eTerrestrial : Constants::eMarine))!=0;
+    }
+private:
+    int _bx0,_by0,_nx,_ny;
+    int _minX,_minY,_width,_height;
+    std::vector<uint64_t> _bits;
+    Environment* _env;
+};
+#endif
@@ -0,0 +1,57 @@
+/*
+ *
+ * SlabPool.cpp
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+#include <algorithm>
+#include <new>
+#include "SlabPool.h"
+
+SlabPool::SlabPool(size_t blockSize,size_t slabSize):_inUse(0),_capacity(0),_free(NULL){
+    //every block must hold a free list link and keep the alignment of whatever is put in it
+    const size_t align=alignof(std::max_align_t);
+    _blockSize=std::max(blockSize,sizeof(FreeBlock));
+    _blockSize=((_blockSize+align-1)/align)*align;
+    _slabSize=std::max(slabSize,size_t(1));
+}
+//------------------------------------------------------------------------------------------------------------
+SlabPool::~SlabPool(){
+    for (auto s:_slabs)::operator delete(s);
+}
+//------------------------------------------------------------------------------------------------------------
+void SlabPool::setSlabSize(size_t n){
+    std::lock_guard<std::mutex> guard(_lock);
+    _slabSize=std::max(n,size_t(1));
+}
+//------------------------------------------------------------------------------------------------------------
+void SlabPool::addSlab(){
+    char* s=static_cast<char*>(::operator new(_blockSize*_slabSize));
+    _slabs.push_back(s);
+    //thread the new blocks onto the free list in address order, so consecutive allocations are contiguous
+    for (size_t i=_slabSize;i>0;i--){
+        FreeBlock* b=reinterpret_cast<FreeBlock*>(s+(i-1)*_blockSize);
+        b->_next=_free;
+        _free=b;
+    }
+    _capacity+=_slabSize;
+}
+//------------------------------------------------------------------------------------------------------------
+void* SlabPool::allocate(){
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_free==NULL)addSlab();
+    FreeBlock* b=_free;
+    _free=b->_next;
+    _inUse++;
+    return b;
+}
+//------------------------------------------------------------------------------------------------------------
+void SlabPool::release(void* p){
+    if (p==NULL) return;
+    std::lock_guard<std::mutex> guard(_lock);
+    FreeBlock* b=static_cast<FreeBlock*>(p);
+    b->_next=_free;
+    _free=b;
+    _inUse--;
+}
@@ -0,0 +1,47 @@
+/*
+ *
+ * SlabPool.h
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+
+#ifndef SLABPOOL_H
+#define SLABPOOL_H
+#include <cstddef>
+#include <mutex>
+#include <vector>
+//------------------------------------------------------------------------------------------
+//Fixed size block allocator used for Human agents (see Human::operator new/delete). Blocks are carved out of slabs of
+//simulation.AgentSlabSize blocks at a time, and blocks given back (agents that die, or migrate/are ghosted off this rank)
+//go onto a free list threaded through the blocks themselves, to be handed out again before any new slab is allocated.
+//Slabs are only released when the pool itself goes, so memory use stays at the peak number of agents on the rank.
+//------------------------------------------------------------------------------------------
+class SlabPool {
+public:
+    SlabPool(size_t blockSize,size_t slabSize=4096);
+    ~SlabPool();
+    void* allocate();
+    void  release(void*);
+    //number of blocks per slab for slabs allocated from now on
+    void setSlabSize(size_t);
+    size_t blockSize() const {return _blockSize;}
+    size_t slabSize() const {return _slabSize;}
+    //blocks currently handed out, and total blocks in all slabs
+    size_t inUse() const {return _inUse;}
+    size_t capacity() const {return _capacity;}
+    //heap bytes held: every slab, in use or not, and the list of slabs
+    size_t bytes() const {return _capacity*_blockSize+_slabs.capacity()*sizeof(char*);}
+private:
+    SlabPool(const SlabPool&)=delete;
+    SlabPool& operator=(const SlabPool&)=delete;
+    void addSlab();
+    struct FreeBlock{FreeBlock* _next;};
+    size_t _blockSize,_slabSize;
+    size_t _inUse,_capacity;
+    FreeBlock* _free;
+    std::vector<char*> _slabs;
+    //births and migrants are added serially, but keep the pool safe if agents are ever made on several threads
+    std::mutex _lock;
+};
+#endif
@@ -0,0 +1,68 @@
+/*
+ *
+ * SusceptiblePool.cpp
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+#include <math.h>
+#include <algorithm>
+#include "SusceptiblePool.h"
+#include "Human.h"
+#include "RandomStreams.h"
+
+SusceptiblePool::SusceptiblePool():_xlo(0),_xhi(0),_ylo(0),_yhi(0),_width(1),_noLongitudeWrap(true),_weight(1){}
+//------------------------------------------------------------------------------------------------------------
+void SusceptiblePool::setup(int xlo,int xhi,int ylo,int yhi,int minX,int maxX,bool noLongitudeWrap,double weight){
+    _weight=weight;
+    _xlo=xlo;_xhi=xhi;_ylo=ylo;_yhi=yhi;
+    _width=maxX-minX+1;
+    _noLongitudeWrap=noLongitudeWrap;
+    clear();
+}
+//------------------------------------------------------------------------------------------------------------
+void SusceptiblePool::clear(){
+    _counts.assign((_xhi-_xlo)*(_yhi-_ylo),std::array<unsigned,numberOfSexes>{0,0});
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned SusceptiblePool::total(int x,int y) const{
+    const std::array<unsigned,numberOfSexes>& c=_counts[index(x,y)];
+    return c[female]+c[male];
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned long SusceptiblePool::total() const{
+    unsigned long t=0;
+    for (auto& c:_counts)t+=c[female]+c[male];
+    return t;
+}
+//------------------------------------------------------------------------------------------------------------
+void SusceptiblePool::addSource(int x,int y,Human* h,std::map<unsigned,double>& logEscape) const{
+    if (!h->_alive || !h->canInfect()) return;
+    double dx=fabs(h->_location[0]-(x+0.5));
+    if (!_noLongitudeWrap)dx=std::min(dx,_width-dx);
+    double dy=fabs(h->_location[1]-(y+0.5));
+    double overlap=std::min(std::max(1.5-dx,0.),1.)*std::min(std::max(1.5-dy,0.),1.);
+    if (overlap<=0) return;
+    for (unsigned id=0;id<DiseaseRegistry::size();id++){
+        disease& d=h->_diseases[id];
+        if (!d.present() || !d.infectious()) continue;
+        double p=d.infectionProb()*overlap;
+        logEscape[id]+=_weight*((p<1.) ? log(1.-p) : -1.e3);
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+std::map<unsigned,std::array<unsigned,SusceptiblePool::numberOfSexes> > SusceptiblePool::draw(int x,int y,const std::map<unsigned,double>& logEscape){
+    std::map<unsigned,std::array<unsigned,numberOfSexes> > infected;
+    std::array<unsigned,numberOfSexes>& c=_counts[index(x,y)];
+    for (auto& [name,l]:logEscape){
+        double p=1.-exp(l);
+        if (p<=0) continue;
+        std::array<unsigned,numberOfSexes> n;
+        for (unsigned s=0;s<numberOfSexes;s++){
+            n[s]=RandomStreams::binomial(c[s],p);
+            c[s]-=n[s];
+        }
+        if (n[female]+n[male]>0)infected[name]=n;
+    }
+    return infected;
+}
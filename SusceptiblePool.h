@@ -0,0 +1,53 @@
+/*
+ *
+ * SusceptiblePool.h
+ *
+ *  Created on: October 17, 2026
+ *
+ */
+
+#ifndef SUSCEPTIBLEPOOL_H
+#define SUSCEPTIBLEPOOL_H
+#include <vector>
+#include <array>
+#include <string>
+#include <map>
+class Human;
+//------------------------------------------------------------------------------------------
+//Susceptible humans held as counts per local cell (by sex) rather than as individual agents (simulation.LazySusceptibles=true).
+//Almost everyone in a large run stays susceptible, and as agents they only cost memory and get scanned every step. Pooled
+//susceptibles do not move; a Human agent is created for one (see MadModel::infectPool, which calls createHuman) when it gets infected.
+//Pooled susceptibles have no position within their cell, so they are taken to be uniformly spread over it: an infectious human
+//at distance d (in cell widths, per dimension, as Human::inDistance) from the cell centre can reach a fraction
+//clamp(1.5-d,0,1) of the cell in each dimension, and a pooled susceptible is infected with probability 1-product(1-p*overlap)
+//over infectious humans in range. This is the pairwise rule averaged over positions in the cell.
+//------------------------------------------------------------------------------------------
+class SusceptiblePool {
+public:
+    enum sexes {female=0,male=1,numberOfSexes=2};
+    //pool restart files (MadModel::writePoolRestart) start with this - change it if the layout of the counts changes
+    static const unsigned restartFormat=0x53500001;
+    SusceptiblePool();
+    void setup(int xlo,int xhi,int ylo,int yhi,int minX,int maxX,bool noLongitudeWrap,double weight=1);
+    unsigned& count(int x,int y,unsigned sex){return _counts[index(x,y)][sex];}
+    unsigned total(int x,int y) const;
+    //all pooled susceptibles on this rank
+    unsigned long total() const;
+    void clear();
+    //add the chance of infection in local cell x,y from an infectious human (any disease it is infectious with) to the log escape probabilities
+    void addSource(int x,int y,Human*,std::map<unsigned,double>& logEscape) const;
+    //number of pooled susceptibles of each sex in cell x,y to infect with each disease - these are removed from the pool
+    //(diseases are by DiseaseRegistry id)
+    std::map<unsigned,std::array<unsigned,numberOfSexes> > draw(int x,int y,const std::map<unsigned,double>& logEscape);
+    //heap bytes held by the counts
+    size_t bytes() const {return _counts.capacity()*sizeof(_counts[0]);}
+private:
+    int index(int x,int y) const {return (x-_xlo)+(_xhi-_xlo)*(y-_ylo);}
+    int _xlo,_xhi,_ylo,_yhi;
+    int _width;
+    bool _noLongitudeWrap;
+    //people per human or pooled count (simulation.AgentWeight)
+    double _weight;
+    std::vector< std::array<unsigned,numberOfSexes> > _counts;
+};
+#endif
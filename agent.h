@@ -1,8 +1,69 @@
 /* Agent.h */
 #ifndef AGENT
 #define AGENT
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <vector>
+#include <boost/mpi/datatype.hpp>
+#include <boost/serialization/is_bitwise_serializable.hpp>
+#include <boost/serialization/level.hpp>
+#include <boost/serialization/tracking.hpp>
 #include "repast_hpc/AgentId.h"
+//------------------------------------------------------------------------------------------
+//x,y position held inline in the agent (and in AgentPackage) - no heap allocation, unlike std::vector<double>
+struct ExactCoordinates {
+    double _xy[2];
+    ExactCoordinates(){_xy[0]=0;_xy[1]=0;}
+    ExactCoordinates(double x,double y){_xy[0]=x;_xy[1]=y;}
+    double operator[](unsigned i) const {return _xy[i];}
+    //true if every cell number from lo to hi can be held
+    static bool covers(int lo,int hi){return true;}
+	template<class Archive>
+	void serialize(Archive& ar, const unsigned int version) {
+        ar & _xy;
+    }
+};
+//------------------------------------------------------------------------------------------
+//the same position as a 16 bit cell number plus a 16 bit fraction of a cell in each direction - 8 bytes rather than 16 in agents,
+//packages and restart files. Positions read back as the centre of their 1/65536 of a cell, so are never more than
+//about 8e-6 of a cell from the value stored, and int() of a position is always its cell. Cell numbers are limited to
+//-32768..32767 (a global grid of cells down to about 0.011 degrees) - the model checks the grid fits at startup.
+struct QuantisedCoordinates {
+    int16_t  _cell[2];
+    uint16_t _offset[2];
+    QuantisedCoordinates(){set(0,0.);set(1,0.);}
+    QuantisedCoordinates(double x,double y){set(0,x);set(1,y);}
+    double operator[](unsigned i) const {return _cell[i]+(_offset[i]+0.5)/65536.;}
+    static bool covers(int lo,int hi){return lo>=INT16_MIN && hi<=INT16_MAX;}
+	template<class Archive>
+	void serialize(Archive& ar, const unsigned int version) {
+        ar & _cell;
+        ar & _offset;
+    }
+private:
+    void set(unsigned i,double v){
+        double c=floor(v);
+        _cell[i]=int16_t(c);
+        _offset[i]=uint16_t(std::min(floor((v-c)*65536.),65535.));
+    }
+};
+//------------------------------------------------------------------------------------------
+//build with -DQUANTISED_POSITIONS for the compact positions
+#ifdef QUANTISED_POSITIONS
+typedef QuantisedCoordinates Coordinates;
+#else
+typedef ExactCoordinates Coordinates;
+#endif
+//plain data - copied as bytes in packages
+BOOST_IS_MPI_DATATYPE(ExactCoordinates)
+BOOST_IS_BITWISE_SERIALIZABLE(ExactCoordinates)
+BOOST_CLASS_IMPLEMENTATION(ExactCoordinates,object_serializable)
+BOOST_CLASS_TRACKING(ExactCoordinates,track_never)
+BOOST_IS_MPI_DATATYPE(QuantisedCoordinates)
+BOOST_IS_BITWISE_SERIALIZABLE(QuantisedCoordinates)
+BOOST_CLASS_IMPLEMENTATION(QuantisedCoordinates,object_serializable)
+BOOST_CLASS_TRACKING(QuantisedCoordinates,track_never)
 
 class MadAgent{
 	
@@ -10,10 +71,13 @@ protected:
     repast::AgentId   _id;
 
 public:
-    MadAgent(){_moved=false;_alive=true;_location={0,0};_destination=_location;}
-    MadAgent(repast::AgentId id): _id(id){_moved=false;_alive=true;_location={0,0};_destination=_location;}
+    MadAgent(){_moved=false;_alive=true;_cellIndex=-1;_cellSlot=0;}
+    MadAgent(repast::AgentId id): _id(id){_moved=false;_alive=true;_cellIndex=-1;_cellSlot=0;}
 	bool _moved;
     bool _alive;
+    //position of this agent in the model CellIndex (bucket number and place in that bucket) - not copied across threads
+    int _cellIndex;
+    unsigned _cellSlot;
 
     virtual ~MadAgent(){};
 	
@@ -22,12 +86,12 @@ public:
     virtual const repast::AgentId& getId() const {      return _id;    }
 	
     //locations in *fractions of a grid cell* at a given long/lat.
-    std::vector<double> _location,_destination;
-    std::vector<double> getLocation(){return _location;}
-    void setLocation(double x, double y){_location={x,y};}
-    void setDestination(double x, double y){_destination={x,y};}
-    void setLocation(std::vector<double>d){_location=d;}
-    void setDestination(std::vector<double>d){_destination=d;}
+    Coordinates _location,_destination;
+    const Coordinates& getLocation() const {return _location;}
+    void setLocation(double x, double y){_location=Coordinates(x,y);}
+    void setDestination(double x, double y){_destination=Coordinates(x,y);}
+    void setLocation(const Coordinates& d){_location=d;}
+    void setDestination(const Coordinates& d){_destination=d;}
 };
 
 #endif
@@ -1,23 +1,53 @@
+#include <iostream>
+#include <cstdlib>
 #include "disease.h"
 #include "TimeStep.h"
-void disease::infect(){_infected=true;_timer=0;}
-void disease::recover(){_recovered=true;_infectious=false;}
-void disease::becomeInfectious(){_infectious=true;}
-double disease::infectionProb(){return _infectionProb;}
-bool disease::infected(){return _infected;}
-bool disease::recovered(){return _recovered;}
-bool disease::infectious(){return _infectious;}
-disease::disease(){
-           bool _infected=false;
-           bool _recovered=false;
-           bool _infectious=false;
-           unsigned _timer=0;
-           _infectionProb=0.1;
+//------------------------------------------------------------------------------------------------------------
+std::vector<std::string>& DiseaseRegistry::names(){
+    static std::vector<std::string> n={"covid"};
+    return n;
 }
-void disease::update(){
+//------------------------------------------------------------------------------------------------------------
+std::vector<double>& DiseaseRegistry::infectionProbs(){
+    static std::vector<double> p={0.1};
+    return p;
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned DiseaseRegistry::find(const std::string& name){
+    std::vector<std::string>& n=names();
+    for (unsigned i=0;i<n.size();i++)if (n[i]==name)return i;
+    return NoDisease;
+}
+//------------------------------------------------------------------------------------------------------------
+unsigned DiseaseRegistry::id(const std::string& name){
+    unsigned i=find(name);
+    if (i!=NoDisease) return i;
+    if (names().size()>=MaxDiseases){
+        std::cout<<"Too many diseases: "<<name<<" would be number "<<names().size()+1<<" but DiseaseRegistry::MaxDiseases is "<<MaxDiseases<<std::endl;
+        exit(1);
+    }
+    names().push_back(name);
+    infectionProbs().push_back(0.1);
+    return names().size()-1;
+}
+//------------------------------------------------------------------------------------------------------------
+void disease::infect(){_flags|=presentFlag|infectedFlag;_timer=0;}
+void disease::recover(){_flags|=recoveredFlag;_flags&=~infectiousFlag;}
+void disease::becomeInfectious(){_flags|=infectiousFlag;}
+double disease::infectionProb(){return DiseaseRegistry::infectionProb(_id);}
+bool disease::infected(){return _flags & infectedFlag;}
+bool disease::recovered(){return _flags & recoveredFlag;}
+bool disease::infectious(){return _flags & infectiousFlag;}
+unsigned disease::timer(){return _timer;}
+disease::disease(unsigned id):_id(id),_flags(0),_timer(0){
+}
+bool disease::update(){
     double _DaysInATimeStep=TimeStep::instance()->DaysPerTimeStep();
-    _timer++;
+    uint8_t flags=_flags;
+    //timer saturates rather than wrapping round to a newly infected state
+    if (_timer<UINT16_MAX)_timer++;
     if (float(_timer)*_DaysInATimeStep> 2) becomeInfectious();
     if (float(_timer)*_DaysInATimeStep> 10) recover();
     //if (someconditione) die();
+    return _flags!=flags;
 }
@@ -7,12 +7,45 @@
 
 #ifndef DISEASE_H
 #define DISEASE_H
+#include <string>
+#include <vector>
+#include <cstdint>
 #include <boost/serialization/access.hpp>
+#include <boost/mpi/datatype.hpp>
+#include <boost/serialization/is_bitwise_serializable.hpp>
+#include <boost/serialization/level.hpp>
+#include <boost/serialization/tracking.hpp>
+//------------------------------------------------------------------------------------------
+//Diseases are known by small integer ids handed out by the registry at startup, so that agents can hold their
+//disease state in a fixed array rather than a map keyed by name. "covid" is always registered first (id 0);
+//other names are added the first time they are used. Ids follow the order of registration, so every rank must
+//register the same names in the same order (as happens when the same code runs everywhere) - registration
+//is not thread safe, so new names should only appear outside the threaded passes.
+//------------------------------------------------------------------------------------------
+class DiseaseRegistry {
+public:
+    //largest number of different diseases an agent can carry
+    static const unsigned MaxDiseases=4;
+    static const unsigned covid=0;
+    static const unsigned NoDisease=MaxDiseases;
+    //id for name, registering it if new
+    static unsigned id(const std::string& name);
+    //id for name, or NoDisease if it has not been registered
+    static unsigned find(const std::string& name);
+    static const std::string& name(unsigned id){return names()[id];}
+    static unsigned size(){return names().size();}
+    static double infectionProb(unsigned id){return infectionProbs()[id];}
+private:
+    static std::vector<std::string>& names();
+    static std::vector<double>& infectionProbs();
+};
+//------------------------------------------------------------------------------------------
 //serialize method is included so that agents can serialize diseases in AgentPackage.h
 //NB to get boost serialize to a file to work data here has to be initialized - otherwise it crashes with an error on archive input.
+//State is packed into four bytes: the disease id, flag bits and a timer counting updates since infection.
 class disease {
 public:
-    disease();
+    disease(unsigned id=DiseaseRegistry::covid);
     void infect();
     bool infected();
     bool infectious();
@@ -20,23 +53,32 @@ public:
     double infectionProb();
     void recover();
     bool recovered();
-    void update();
+    //advance one step - returns true if the flags changed (became infectious or recovered), not just the timer
+    bool update();
+    //number of updates since infection
+    unsigned timer();
+    //true once the agent carries this disease (infected or not)
+    bool present(){return _flags & presentFlag;}
+    void setPresent(){_flags|=presentFlag;}
+    unsigned id(){return _id;}
 private:
-    bool _infected=false;
-    bool _recovered=false;
-    bool _infectious=false;
-    double _infectionProb=0.5;
-    unsigned _timer=0;
+    enum flags {presentFlag=1,infectedFlag=2,infectiousFlag=4,recoveredFlag=8};
+    uint8_t _id=DiseaseRegistry::covid;
+    uint8_t _flags=0;
+    uint16_t _timer=0;
     friend class boost::serialization::access;
 	template<class Archive>
 	void serialize(Archive& ar, const unsigned int version) {
-        ar & _infected;
-        ar & _recovered;
-        ar & _infectious;
+        ar & _id;
+        ar & _flags;
         ar & _timer;
-        ar & _infectionProb;
 
     }
 };
+//plain data - copied as bytes in packages
+BOOST_IS_MPI_DATATYPE(disease)
+BOOST_IS_BITWISE_SERIALIZABLE(disease)
+BOOST_CLASS_IMPLEMENTATION(disease,object_serializable)
+BOOST_CLASS_TRACKING(disease,track_never)
 
 #endif /* DISEASE_H */
@@ -78,6 +78,9 @@ void runModel(Properties& props, int argc, char ** argv) {
       model->initSchedule(startStep+1,runner);
 	  model->tests();
       //layerTester::tests();
+    }else if (props.getProperty("run.benchmarks")=="true"){
+	  model->init(startStep+1);
+	  model->benchmarks();
     }else{
 	  model->init(startStep+1);
 	  model->initSchedule(startStep+1,runner);
@@ -115,8 +118,9 @@ int main(int argc, char **argv) {
     //original model has no cross-cell interaction, so grid buffers are not needed
     props.putProperty("grid.buffer",0);
     //if there is cross-cell interaction, dispersal should be direct and grid buffer 2
+    //unless infectious humans near rank edges are sent as compact records instead of buffer zone copies (simulation.InfectiousHalo=true)
     if (props.getProperty("simulation.CrossCellInteraction")=="true"){
-        if (world.size() > 1)props.putProperty("grid.buffer",1);
+        if (world.size() > 1 && props.getProperty("simulation.InfectiousHalo")!="true")props.putProperty("grid.buffer",1);
        //   if (world.rank()==0 && world.size()<4) {cout<<"\n *********** Cross cell interaction currently requires at least 4 cores ***********"<<endl; exit(1);}
     }
   //initialise parameters and read datafiles
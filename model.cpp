@@ -2,6 +2,8 @@
 
 #include <stdio.h>
 #include <vector>
+#include <algorithm>
+#include <random>
 #include <sstream>
 #include <fstream>
 #include <boost/filesystem.hpp>
@@ -45,6 +47,8 @@
 #include "RandomRepast.h"
 #include "AgentPackage.h"
 #include "UtilityFunctions.h"
+#include "RandomStreams.h"
+#include "DistanceKernel.h"
 
 #include <netcdf>
 
@@ -108,6 +112,11 @@ MadModel::MadModel(repast::Properties& props,  boost::mpi::communicator* comm):
     _minY=repast::strToInt(_props->getProperty("min.y"));
     _maxX=repast::strToInt(_props->getProperty("max.x"));
     _maxY=repast::strToInt(_props->getProperty("max.y"));
+    if (!Coordinates::covers(std::min(_minX,_minY),std::max(_maxX,_maxY))){
+        if (repast::RepastProcess::instance()->rank()==0)cout<<"Grid cell numbers "<<_minX<<".."<<_maxX<<", "<<_minY<<".."<<_maxY<<" are too large for quantised positions - build without QUANTISED_POSITIONS"<<endl;
+        MPI_Finalize();
+        exit(1);
+    }
     _dimX=repast::strToInt(_props->getProperty("proc.per.x"));
     _dimY=repast::strToInt(_props->getProperty("proc.per.y"));
     _noLongitudeWrap=repast::strToInt(_props->getProperty("noLongitudeWrap"));
@@ -186,6 +195,64 @@ MadModel::MadModel(repast::Properties& props,  boost::mpi::communicator* comm):
     _xhi= _xlo + discreteSpace->dimensions().extents().getX();
     _ylo=        discreteSpace->dimensions().origin().getY() ;
     _yhi= _ylo + discreteSpace->dimensions().extents().getY();
+    //with cross-cell interaction, infectious humans near the edges of other ranks can be sent as compact records
+    //(simulation.InfectiousHalo=true - see main.cpp, which then leaves grid.buffer at 0) - the halo of cells here is still needed to hold them
+    _infectiousHalo=(props.getProperty("simulation.CrossCellInteraction")=="true" && props.getProperty("simulation.InfectiousHalo")=="true");
+    int halo=gridBuffer;
+    if (_infectiousHalo)halo=std::max(halo,1);
+    //agents get bucketed by cell on this thread - buffer zone cells hold copies of agents from other threads
+    _cells.setup(_xlo,_xhi,_ylo,_yhi,halo,_minX,_maxX,_minY,_maxY);
+    //interaction is either pairwise (the default) or via a per cell force of infection
+    _forceOfInfection=(props.getProperty("simulation.InteractionMode")=="forceOfInfection");
+    unsigned subCells=1;
+    if (props.getProperty("simulation.ForceOfInfectionSubCells")!="")subCells=repast::strToInt(props.getProperty("simulation.ForceOfInfectionSubCells"));
+    //threads within this MPI rank - each needs its own force of infection workspace
+    _threads=1;
+    if (props.getProperty("simulation.Threads")!="")_threads=repast::strToInt(props.getProperty("simulation.Threads"));
+    RandomStreams::Initialise(_randomSeed,repast::RepastProcess::instance()->rank(),_threads);
+    _threads=RandomStreams::threads();
+    //each human (or pooled count) can stand for several people - recorded in RunParameters, as it scales all the outputs
+    _agentWeight=1;
+    if (props.getProperty("simulation.AgentWeight")!="")_agentWeight=repast::strToDouble(props.getProperty("simulation.AgentWeight"));
+    if (_agentWeight<1){
+        if (repast::RepastProcess::instance()->rank()==0)cout<<"simulation.AgentWeight ("<<_agentWeight<<") must be at least 1"<<endl;
+        MPI_Finalize();
+        exit(1);
+    }
+    props.putProperty("simulation.AgentWeight",_agentWeight);
+    //ghost updates send everything every this many state syncs (1 for every time), otherwise only changes
+    _ghostRefreshInterval=10;_stateSyncs=0;
+    if (props.getProperty("simulation.GhostRefreshInterval")!="")_ghostRefreshInterval=std::max(1,repast::strToInt(props.getProperty("simulation.GhostRefreshInterval")));
+    //agents move at most one cell per timestep, so migration normally only needs the neighbouring ranks
+    _neighbourMigration=(props.getProperty("simulation.Migration")=="neighbours");
+    _longJump=false;_pollFallbacks=0;
+    _ranks.setup(_dimX,_dimY,_xlo,_xhi,_ylo,_yhi,_minX,_maxX,_minY,_maxY);
+    for(int y = _ylo; y < _yhi; y++)for(int x = _xlo; x < _xhi; x++)_localCells.push_back({x,y});
+    //overlap the buffer zone update in step() with work on interior cells
+    _overlapHalo=(props.getProperty("simulation.OverlapHalo")=="true");
+    _halo.setup(_ranks,_xlo,_xhi,_ylo,_yhi,halo);
+    //humans are allocated from slabs of this many agents at a time
+    if (props.getProperty("simulation.AgentSlabSize")!="")Human::_Pool.setSlabSize(repast::strToInt(props.getProperty("simulation.AgentSlabSize")));
+    _foi.resize(_threads);
+    for (auto& f:_foi)f.setup(subCells,_minX,_maxX,_noLongitudeWrap,_agentWeight);
+    //cells with more agents than this are split into several tasks in the threaded passes
+    unsigned splitSize=1000;
+    if (props.getProperty("simulation.TaskSplitSize")!="")splitSize=repast::strToInt(props.getProperty("simulation.TaskSplitSize"));
+    _scheduler.setup(_threads,splitSize);
+    _lazySusceptibles=(props.getProperty("simulation.LazySusceptibles")=="true");
+    _pool.setup(_xlo,_xhi,_ylo,_yhi,_minX,_maxX,_noLongitudeWrap,_agentWeight);
+    //cells switch between counts and individual humans - susceptibles are always pooled in this case
+    _hybridCells=(props.getProperty("simulation.HybridCells")=="true");
+    if (_hybridCells)_lazySusceptibles=true;
+    _promoteBelow=50;_demoteAbove=500;
+    if (props.getProperty("simulation.HybridPromoteBelow")!="")_promoteBelow=repast::strToInt(props.getProperty("simulation.HybridPromoteBelow"));
+    if (props.getProperty("simulation.HybridDemoteAbove") !="")_demoteAbove =repast::strToInt(props.getProperty("simulation.HybridDemoteAbove"));
+    if (_hybridCells && _promoteBelow>=_demoteAbove){
+        if (repast::RepastProcess::instance()->rank()==0)cout<<"simulation.HybridPromoteBelow ("<<_promoteBelow<<") must be less than simulation.HybridDemoteAbove ("<<_demoteAbove<<")"<<endl;
+        MPI_Finalize();
+        exit(1);
+    }
+    _compartments.setup(_xlo,_xhi,_ylo,_yhi,_minX,_maxX,_minY,_maxY,_noLongitudeWrap,_agentWeight);
 
 }
 //------------------------------------------------------------------------------------------------------------
@@ -193,6 +260,7 @@ MadModel::~MadModel(){
 
 	delete provider;
 	delete receiver;
+    for (auto h:_standIns)delete h;
     for (size_t i = 0; i < dataSets.size(); ++i) {
 		delete dataSets[i];
 	}
@@ -205,6 +273,7 @@ void MadModel::initSchedule(unsigned startingStep,repast::ScheduleRunner& runner
 	runner.scheduleEvent(startingStep, 1, repast::Schedule::FunctorPtr(new repast::MethodFunctor<MadModel> (this, &MadModel::step)));
 	runner.scheduleStop(_stopAt);
     runner.scheduleEndEvent(Schedule::FunctorPtr(new MethodFunctor<MadModel> (this, &MadModel::dataSetClose)));
+    runner.scheduleEndEvent(Schedule::FunctorPtr(new MethodFunctor<MadModel> (this, &MadModel::reportThreadLoad)));
 
 }
 //------------------------------------------------------------------------------------------------------------
@@ -226,6 +295,8 @@ void MadModel::init(unsigned startingStep){
     //now set up the environmental cells - note at present this uses the full grid, not just local to this thread
     //so that off-thread environment can be easily queried. Currently some duplication here, but it is not a huge amount of data.
     _Env=Environment(_minX,_maxX,_minY,_maxY);
+    //dispersal steps are less than a cell, so one cell of halo (or the buffer zone if wider) covers them
+    _land.setup(_xlo,_xhi,_ylo,_yhi,std::max(1,repast::strToInt(_props->getProperty("grid.buffer"))),_minX,_maxX,_minY,_maxY,_Env);
 
     //set up the static (i.e. shared) parameters for the Humans
     Human::setParameters(_props);
@@ -267,7 +338,6 @@ void MadModel::init(unsigned startingStep){
 
   
     int s=0,q=0;
-    unsigned hF=10000;//functionalgroup ID for humans
     if (_restartStep==0){
         for (int x = _xlo; x < _xhi; x++){
             for (int y = _ylo; y < _yhi; y++){
@@ -275,48 +345,37 @@ void MadModel::init(unsigned startingStep){
                 double lon=E->Longitude();
                 double lat=E->Latitude();
                 
-                if (E->_Realm=="terrestrial"){
+                if (E->_Realm==Constants::eTerrestrial){
                     humanCount=E->Population();
+                    //with weighted agents round the number of humans up or down at random, so the expected population is unchanged -
+                    //unweighted runs keep the original count and random stream
+                    if (_agentWeight!=1){
+                        double weighted=E->Population()/_agentWeight;
+                        humanCount=unsigned(weighted);
+                        if (weighted>humanCount && random->GetUniform()<weighted-humanCount)humanCount++;
+                    }
                     //cout<<lon<<" "<<lat<<" h "<<humanCount<<": ";
                     for (unsigned j=0;j<humanCount;j++){
-                        //make sure the agentId is unique on this thread!!
-                        // values are int id, int startProc, int agentType, 
-                        repast::AgentId id(Human::_NextID, rank, _humanType);
-                        //agent also needs id of its current thread
-                        id.currentRank(rank);
-                        Human* h = new Human(id);
-                        h->setup(hF,humanCount, E,random);
+                        bool seed=(q==0 && lon<=-0.29 && lon>-0.31 && lat<=51.51 && lat > 51.49);
+                        //with lazy susceptibles only the seed infection needs to be an agent - everyone else is counted in the pool
+                        if (_lazySusceptibles && !seed){
+                            unsigned sex=SusceptiblePool::female;
+                            if (random->GetUniform()<0.5)sex=SusceptiblePool::male;
+                            _pool.count(x,y,sex)++;
+                            _totalSusceptible++;
+                            _totalPopulation++;
+                            continue;
+                        }
+                        Human* h = createHuman(x,y,random);
                         
     
-                        if (q==0 && lon<=-0.29 && lon>-0.31 && lat<=51.51 && lat > 51.49){q++;h->_diseases["covid"].infect();cout<<lon<<" "<<lat<<endl;}
-
-                        _context.addAgent(h);
-                        //to get movement right agent needs its own copy of location
-                        double xr=0,yr=0;
-                        if (_dispersalSelection=="direct"){
-                            //allow cohorts to be at locations other than cell centres initially - note using fractional cell co-ordinates
-                            xr=(1-2*random->GetUniform())*0.5;
-                            yr=(1-2*random->GetUniform())*0.5;
-                            if (y+yr <  _minX)    {yr = -yr;}
-                            if (y+yr >= _maxX + 1){yr = -yr;}
-                            if (!_noLongitudeWrap){
-                                if (x+xr <  _minX)    {xr = xr + (_maxX - _minX + 1);}
-                                if (x+xr >= _maxX + 1){xr = xr - (_maxX - _minX + 1);}
-                            } else {
-                                if (x+xr <  _minX)    {xr = -xr;}
-                                if (x+xr >= _maxX + 1){xr = -xr;}
-                            }
-                        }
-                        assert(y+yr >= _minY);
-                        repast::Point<int> initialLocation(x+xr,y+yr);
-                        discreteSpace->moveTo(id, initialLocation);
-                        //to get movement right agent needs its own copy of location
-                        h->setLocation(x+xr,y+yr);
+                        if (seed){q++;h->infectWith(DiseaseRegistry::covid);_cells.refresh(h,columnState(h));cout<<lon<<" "<<lat<<endl;}
+
                         //code needed here for output totals - S/L/I/R/D etc.
-                        if (h->hasDisease("covid")){
+                        if (h->hasDisease(DiseaseRegistry::covid)){
                             if (h->_alive){
-                                if (!h->recoveredFrom("covid"))_totalInfected++;
-                                if ( h->recoveredFrom("covid"))_totalRecovered++;
+                                if (!h->recoveredFrom(DiseaseRegistry::covid))_totalInfected++;
+                                if ( h->recoveredFrom(DiseaseRegistry::covid))_totalRecovered++;
                                 _totalPopulation++; 
                             }else{
                                 _totalDied++;
@@ -336,16 +395,31 @@ void MadModel::init(unsigned startingStep){
                      
     if (_restartStep>0){
         read_restart(_restartStep);
+        if (_lazySusceptibles){
+            readPoolRestart(_restartStep);
+            _totalSusceptible+=_pool.total();
+            _totalPopulation+=_pool.total();
+        }
+        if (_hybridCells){
+            readCompartmentRestart(_restartStep);
+            for(int y = _ylo; y < _yhi; y++){
+                for(int x = _xlo; x < _xhi; x++){
+                    _totalInfected +=_compartments.infected(x,y);
+                    _totalRecovered+=_compartments.recovered(x,y);
+                    _totalPopulation+=_compartments.infected(x,y)+_compartments.recovered(x,y);
+                }
+            }
+        }
         vector<MadAgent*>agents;
         _context.selectAgents(repast::SharedContext<MadAgent>::LOCAL,agents);
         for (auto a:agents){
             if (a->getId().agentType()==_humanType){
                 Human* h=(Human *)a;
                //code needed here for output totals - S/L/I/R/D etc.
-                if (h->hasDisease("covid")){
+                if (h->hasDisease(DiseaseRegistry::covid)){
                     if (h->_alive){
-                        if (!h->recoveredFrom("covid"))_totalInfected++;
-                        if ( h->recoveredFrom("covid"))_totalRecovered++;
+                        if (!h->recoveredFrom(DiseaseRegistry::covid))_totalInfected++;
+                        if ( h->recoveredFrom(DiseaseRegistry::covid))_totalRecovered++;
                         _totalPopulation++; 
                     }else{
                         _totalDied++;
@@ -358,6 +432,7 @@ void MadModel::init(unsigned startingStep){
             }
         }
     }
+    scaleTotals();
     if(_verbose)cout<<"rank "<<rank<<" total Infected "<<_totalInfected<<endl;
     if (_output){
      setupOutputs();
@@ -367,7 +442,10 @@ void MadModel::init(unsigned startingStep){
 	std::stringstream ss;
 	ss << t;
 	_props->putProperty("init.time", ss.str());
+    if (_hybridCells)rebalanceCells(_localCells);
     sync();
+    //once the configured population has been made, so there is something to measure
+    if (_props->getProperty("simulation.MemoryReport")=="true" || _props->getProperty("simulation.MemoryBudgetMB")!="")memoryReport();
 
 }
 //------------------------------------------------------------------------------------------------------------
@@ -409,185 +487,210 @@ void MadModel::step(){
     //loop over agents on this thread - using synchronous updates so that update order of agents is not important for disease transfer.
     //For cell interaction, we need to make sure copies are updated appropriately. Since the infection process is one-way, 
     //remote humans in the buffer zone on this thread can update local ones provided their disease data is up-to-date.
-    //Do this over cells as the Moore query is expensive
-    std::vector<MadAgent*> agents;
-bool _cellBased=true;//cell based may be al lot faster if there are significant numbers of humans per cell - fewer Moore lookups
-    if (_cellBased){
-    for(int x = _xlo - range; x < _xhi + range; x++){
-        for(int y = _ylo - range; y < _yhi + range; y++){
-            if (x>= _minX && x<=_maxX && y>= _minY && y<=_maxY){
-                repast::Point<int> location(x,y);
-                
-                //query four neighbouring cells, distance 0 (i.e. just the centre cell) - "true" keeps the centre cell.
-                repast::VN2DGridQuery<MadAgent> VN2DQuery(space());
-                VN2DQuery.query(location, 0, true, agents);
-                std::vector<MadAgent*> thingsToInteract;
-                
-                //things that can be eaten by the agents above - they can be in any of the 
-                //eight neighbouring cells (range =1 - requires grid.buffer=1) plus the current cell, or just the current cell (range=0, grid,buffer=0)
-                repast::Moore2DGridQuery<MadAgent> Moore2DQuery(space());
-                Moore2DQuery.query(location, range, true, thingsToInteract);
-                
-                
-                std::vector<Human*> humansToInteract;
-                
-                for (auto a:thingsToInteract){
-                    if ( a->_alive){//agents must be living but need only be local!
-                        //separate out humans
-                        if (a->getId().agentType()==_humanType && a->getId().currentRank()==rank) {Human* h=(Human*)a;if (!h->hasDisease("covid"))humansToInteract.push_back(h);}
-                    }
-                }
-
-                for (auto& a: agents)((Human *)a)->step(humansToInteract, CurrentTimeStep,this);
-                agents.clear();
-                
+    //Do this over cells using the per-cell lists in _cells (buffer zone cells hold the remote copies) - no repast grid queries needed.
+    //Only cells with infectious humans in range (see findActiveCells) need to be visited.
+    if (_interacting && _infectiousHalo)updateStandIns();
+    if (_interacting){
+    findActiveCells(range);
+    if (_forceOfInfection)takeSources();
+    //cells of one colour are far enough apart that they never infect the same humans, so each colour can be spread over threads.
+    //Tasks cover the whole cell with force of infection, or a slice of the neighbourhood for pairwise interaction:
+    //either way each susceptible is in exactly one task, so busy cells can be split without two threads infecting the same human.
+    for (auto& colour:_activeCells){
+    _scheduler.clear();
+    for (auto& [x,y]:colour){
+        unsigned neighbourhood=0;
+        for (int i=-range;i<=range;i++)for (int j=-range;j<=range;j++){std::vector<MadAgent*>* c=_cells.cell(x+i,y+j);if (c!=NULL)neighbourhood+=c->size();}
+        if (_forceOfInfection) _scheduler.add(x,y,_cells.cell(x,y)->size(),neighbourhood,true);
+        else                   _scheduler.add(x,y,neighbourhood,double(neighbourhood)*_cells.infectiousAt(x,y),true);
+    }
+    if (_forceOfInfection){
+    //infectious humans in range (including remote copies) add to the pressure in each local cell, then each local susceptible gets one draw.
+    //Pressure comes from the sources taken before the pass, never from the humans themselves: with range>0 a neighbouring cell's humans,
+    //and in a split cell this cell's own, may be being infected by another thread.
+    _scheduler.run([&](const CellTask& task){
+        std::vector<MadAgent*>* agents=_cells.cell(task._x,task._y);
+        ForceOfInfection& foi=_foi[RandomStreams::threadNumber()];
+        foi.reset(task._x,task._y);
+        for (int i=-range;i<=range;i++){
+            for (int j=-range;j<=range;j++){
+                int b=_cells.index(task._x+i,task._y+j);
+                if (b>=0) for (auto& s:_sources[b])foi.addSource(s);
             }
         }
-    }
-}else{
-    _context.selectAgents(agents);
-     for (auto& a:agents){ 
-         //find the right location for this human - could be anywhere across the thread
-        std::vector<int> agentLoc;
-        discreteSpace->getLocation(a->getId(), agentLoc);
-        repast::Point<int> location(agentLoc);
-        Human * human=(Human *)a;
-        
-        std::vector<MadAgent*> thingsToInteract;
-        
-        //things that can be eaten by the agents above - they can be in any of the 
+        if (foi.active()) for (unsigned n=task._first;n<task._last;n++) if ((*agents)[n]->getId().agentType()==_humanType)foi.infect((Human*)(*agents)[n]);
+    });
+    }else{
+    _scheduler.run([&](const CellTask& task){
+        std::vector<MadAgent*>* agents=_cells.cell(task._x,task._y);
+
+        //things that can be infected by the agents above - they can be in any of the 
         //eight neighbouring cells (range =1 - requires grid.buffer=1) plus the current cell, or just the current cell (range=0, grid,buffer=0)
-        repast::Moore2DGridQuery<MadAgent> Moore2DQuery(space());
-        Moore2DQuery.query(location, range, true, thingsToInteract);
-        
-        
-        std::vector<Human*> humansToInteract;
-        
-        for (auto a:thingsToInteract){
-            if ( a->_alive){//agents must be living but might not be local!
-                //separate out humans
-                if (a->getId().agentType()==_humanType ) {Human* h=(Human*)a;if (!h->hasDisease("covid"))humansToInteract.push_back(h);}
+        //this task only takes its slice [_first,_last) of the neighbourhood
+        //(kept with contiguous co-ordinates for the distance kernel in Human::interact)
+        //candidates are picked out using the cell columns, so only the humans that can actually be infected get touched
+        //(the susceptible flag may be stale for humans infected earlier in this pass - interact checks each disease again)
+        Candidates humansToInteract;
+        const uint8_t wanted=CellColumns::alive|CellColumns::localHuman|CellColumns::susceptible;//agents must be living but need only be local!
+        unsigned n=0;
+        for (int i=-range;i<=range;i++){
+            for (int j=-range;j<=range;j++){
+                int b=_cells.index(task._x+i,task._y+j);
+                if (b<0) continue;
+                std::vector<MadAgent*>& thingsToInteract=_cells.bucket(b);
+                const CellColumns& columns=_cells.columns(b);
+                unsigned size=thingsToInteract.size();
+                unsigned first=std::max(task._first,n),last=std::min(task._last,n+size);
+                for (unsigned k=first;k<last;k++)if (columns.has(k-n,wanted))humansToInteract.push_back((Human*)thingsToInteract[k-n],columns._x[k-n],columns._y[k-n]);
+                n+=size;
             }
-        }    
+        }
 
-        human->step(humansToInteract, CurrentTimeStep,this);
-        
+        const CellColumns& columns=*_cells.columnsAt(task._x,task._y);
+        for (unsigned k=0;k<agents->size();k++)if (columns.has(k,CellColumns::infectious))((Human *)(*agents)[k])->interact(humansToInteract,this);
+    });
+    }
+    }
     }
-}
 
-    //now diseases can be updated, including newly infected agents. Only local need be updated.
-    agents.clear();
-    _context.selectAgents(repast::SharedContext<MadAgent>::LOCAL,agents);
-    for (auto& a:agents){
-        std::vector<int> agentLoc;
-        discreteSpace->getLocation(a->getId(), agentLoc);
-        int cellIndex=agentLoc[0]-_minX+(_maxX-_minX+1)*(agentLoc[1]-_minY);
-        //double area=_Env[agentLoc[0]][agentLoc[1]]->Area();
-        Human * h=(Human *)a;
-        //advance disease states
-        h->updateDiseases();
-
-        //acumulate other totals and spatial maps
-        if (h->hasDisease("covid")){
-            if (h->_alive){
-                if (!h->recoveredFrom("covid")){_totalInfected++;localMaps["totalInfected"][cellIndex]+= 1.;}
-                if ( h->recoveredFrom("covid")){_totalRecovered++;localMaps["totalRecovered"][cellIndex]+= 1.;}
-                _totalPopulation++; 
-            }else{
-                _totalDied++;localMaps["totalDeaths"][cellIndex]+= 1.;
-            }
-            
-        }else{
-            _totalSusceptible++;localMaps["totalSusceptible"][cellIndex]+= 1.;
-            _totalPopulation++;
+    if (_interacting && _lazySusceptibles)infectPool(range);
+
+    //now the rest of human behaviour, and diseases can be updated, including newly infected agents. Only local need be updated.
+    //Cells are independent here, so can be shared across threads - births and deaths are collected per thread to be added to
+    //(or removed from) the model afterwards. Busy cells are split, so per-cell counts are added atomically.
+    //Refreshing each human in _cells keeps the per-cell S/I/R/D tallies up to date, so the totals and maps are then read off per cell.
+    //All of this, and choosing where humans move to, only involves the cell the humans are in - so it is done for a list of cells at a time.
+    vector<double>& susceptibleMap=localMaps["totalSusceptible"];
+    vector<double>& infectedMap   =localMaps["totalInfected"];
+    vector<double>& recoveredMap  =localMaps["totalRecovered"];
+    vector<double>& deathsMap     =localMaps["totalDeaths"];
+    std::vector< vector<Human*> > movers(_threads);
+    auto updateCells=[&](const std::vector< std::pair<int,int> >& cells){
+    std::vector< std::vector<Human*> > births(_threads),deaths(_threads);
+    _scheduler.clear();
+    for (auto& [x,y]:cells){
+        unsigned n=_cells.cell(x,y)->size();
+        _scheduler.add(x,y,n,n,true);
+    }
+    _scheduler.run([&](const CellTask& task){
+        unsigned thread=RandomStreams::threadNumber();
+        //double area=_Env[x][y]->Area();
+        std::vector<MadAgent*>& agents=*_cells.cell(task._x,task._y);
+        for (unsigned n=task._first;n<task._last;n++){
+            Human * h=(Human *)agents[n];
+            h->step(CurrentTimeStep,this);
+            //advance disease states
+            h->updateDiseases();
+            _cells.refresh(h,columnState(h));
+            //humans can have one offspring per timestep
+            if (h->_alive && h->_newH!=NULL && _reproduction)births[thread].push_back(h);
+            if (!h->_alive && _death)deaths[thread].push_back(h);
+        }
+    });
+    for (auto& [x,y]:cells){
+        int b=_cells.index(x,y),cellIndex=x-_minX+(_maxX-_minX+1)*(y-_minY);
+        unsigned s=_cells.tally(b,CellColumns::S),i=_cells.tally(b,CellColumns::I),r=_cells.tally(b,CellColumns::R),d=_cells.tally(b,CellColumns::D);
+        susceptibleMap[cellIndex]+=s;infectedMap[cellIndex]+=i;recoveredMap[cellIndex]+=r;deathsMap[cellIndex]+=d;
+        _totalSusceptible+=s;_totalInfected+=i;_totalRecovered+=r;_totalDied+=d;_totalPopulation+=s+i+r;
+    }
+    //counted infections progress in the same way as individual ones
+    if (_hybridCells){
+        for (auto& [x,y]:cells){
+            _compartments.update(x,y);
+            int cellIndex=x-_minX+(_maxX-_minX+1)*(y-_minY);
+            unsigned i=_compartments.infected(x,y),r=_compartments.recovered(x,y);
+            infectedMap[cellIndex]+=i;recoveredMap[cellIndex]+=r;
+            _totalInfected+=i;_totalRecovered+=r;_totalPopulation+=i+r;
+        }
+    }
+    //pooled susceptibles stay where they are and only need counting
+    if (_lazySusceptibles){
+        for (auto& [x,y]:cells){
+            unsigned pooled=_pool.total(x,y);
+            susceptibleMap[x-_minX+(_maxX-_minX+1)*(y-_minY)]+=pooled;
+            _totalSusceptible+=pooled;_totalPopulation+=pooled;
         }
     }
+
     //updates of offspring and mergers/death happen after all cells have updated
     //need to keep this separate if there is cross-cell interaction
- 
-    for(int y = _ylo; y < _yhi; y++){  
-     for(int x = _xlo; x < _xhi; x++){
-      int cellIndex=x-_minX+(_maxX-_minX+1)*(y-_minY);
-            
-            //store current location in a repast structure for later use
-            repast::Point<int> location(x,y);
-            
-            std::vector<MadAgent*> agentsInCell;
-            //query four neighbouring cells, distance 0 (i.e. just the centre cell) - "true" keeps the centre cell.
-
-            repast::VN2DGridQuery<MadAgent> VN2DQuery(space());
-            VN2DQuery.query(location, 0, true, agentsInCell);
-
-            std::vector<Human*> humans;
-
-            for (auto a:agentsInCell){
-               if (a->getId().currentRank()==rank && a->_alive){//agents must be local and living!
-                //separate out humans
-                if (a->getId().agentType()==_humanType) humans.push_back( (Human*) a);
-               }
-            }
-
-            //humans can have one offspring per timestep - add the offspring to the model
-            vector<Human*> newHumans;
-            for (auto h:humans)if(h->_newH!=NULL && _reproduction){
-                _context.addAgent(h->_newH);
-                discreteSpace->moveTo(h->_newH->getId(), location);
-                newHumans.push_back(h->_newH);
-                //_totalReproductions++;
-            }
-            //make sure new humans can get marked for death/merged - new humans are guaranteed to be local
-            for (auto n:newHumans){humans.push_back(n);}
-            newHumans.clear();
-            //for (auto h:humans){h->markForDeath();if (!h->_alive)_totalDied++;}
-
-
-            
-            //care with sync() here - need to get rid of not-alive agents:currently this is a lazy delete for new/non-local agents (they get removed one timestep late)?
-            for (auto a:agentsInCell )if (!a->_alive && _death)_context.removeAgent(a->getId());//does this delete the agent storage? - yes if Boost:shared_ptr works OK
-
+    for (auto& b:births){
+        for (auto h:b){
+            //offspring go in the parent's cell - new humans are guaranteed to be local
+            repast::Point<int> location(int(h->_location[0]),int(h->_location[1]));
+            addAgent(h->_newH, location);
+            //_totalReproductions++;
         }
     }
+    //care with sync() here - need to get rid of not-alive agents:currently this is a lazy delete for new/non-local agents (they get removed one timestep late)?
+    for (auto& d:deaths)for (auto h:d)removeAgent(h);//does this delete the agent storage? - yes if Boost:shared_ptr works OK
+
+    if (_hybridCells)rebalanceCells(cells);
+
     if (_dispersal){
     //find out which agents need to move
     //_moved has been set to false for new agents
     //NB this has to happen after above updates to individual Humans (otherwise some cells could get mixed before other have updated, so some humans could get updated twice)
     //Note do this per cell to minimise expensive Env[x][y] lookups
-    vector<Human*> movers;
-    for(int x = _xlo; x < _xhi; x++){
-        for(int y = _ylo; y < _yhi; y++){
-            repast::Point<int> location(x,y);
-            EnvironmentCell* E=_Env[x][y];
-            std::vector<MadAgent*> agentsInCell;
-            //query four neighbouring cells, distance 0 (i.e. just the centre cell) - "true" keeps the centre cell.
-            repast::VN2DGridQuery<MadAgent> VN2DQuery(space());
-            VN2DQuery.query(location, 0, true, agentsInCell);
-
-            for (auto a:agentsInCell){
-                 //dispersers must be local and alive!
-                 if (a->getId().currentRank()==repast::RepastProcess::instance()->rank() && a->_alive){
-                     if (a->getId().agentType()==MadModel::_humanType ) {
-                         ((Human*) a)->moveIt(E,this);
-                         if (a->_moved){ //humans that have changed cell
-                             movers.push_back((Human *) a);a->_moved=false;
-                        }
-                     }
-                }
+    _scheduler.clear();
+    for (auto& [x,y]:cells){
+        unsigned n=_cells.cell(x,y)->size();
+        _scheduler.add(x,y,n,n,true);
+    }
+    _scheduler.run([&](const CellTask& task){
+        unsigned thread=RandomStreams::threadNumber();
+        EnvironmentCell* E=_Env[task._x][task._y];
+        std::vector<MadAgent*>& agents=*_cells.cell(task._x,task._y);
+
+        for (unsigned n=task._first;n<task._last;n++){
+             MadAgent* a=agents[n];
+             //dispersers must be local and alive!
+             if (a->_alive){
+                 if (a->getId().agentType()==MadModel::_humanType ) {
+                     ((Human*) a)->moveIt(E,this);
+                     _cells.refreshLocation(a);
+                     if (a->_moved){ //humans that have changed cell
+                         movers[thread].push_back((Human *) a);a->_moved=false;
+                    }
+                 }
             }
         }
-    }
+    });
     //_totalMoved=movers.size();
+    }
+    };
 
     //agent data may have changed locally - ensure this is synced before anything gets moved, otherwise values do not move across threads correctly when there are buffers.
-    if (buffer==1)repast::RepastProcess::instance()->synchronizeAgentStates<AgentPackage, 
-            MadAgentPackageProvider, MadAgentPackageReceiver>(*provider, *receiver);
+    //With simulation.OverlapHalo=true this update is started as soon as the cells in the buffer zones of other ranks are done,
+    //and completed after the interior cells - otherwise all cells are done first, then synchronizeStates() waits for the exchange.
+    if (_dispersal && buffer==1 && _overlapHalo){
+        updateCells(_halo.boundaryCells());
+        _halo.start(_cells,startStateSync());
+        updateCells(_halo.interiorCells());
+        for (auto& p:_halo.finish())if (_context.contains(p.getId()))receiver->updateAgent(p);
+        finishStateSync();
+    }else{
+        updateCells(_localCells);
+        if (_dispersal && buffer==1)synchronizeStates();
+    }
+    scaleTotals();
+    if (_agentWeight!=1)for (auto& [name,m]:localMaps)for (auto& v:m)v*=_agentWeight;
+    //the maps are now complete - with simulation.OverlapHalo=true they are reduced while agents move and sync
+    //(on the RankNeighbours communicator, so the reductions cannot interfere with repast's messages)
+    std::vector<MPI_Request> mapReductions;
+    if (_output && _overlapHalo){
+        mapReductions.resize(outputNames.size());
+        for (unsigned k=0;k<outputNames.size();k++)MPI_Ireduce(localMaps[outputNames[k]].data(), outputMaps[outputNames[k]].data(), (_maxX-_minX+1) * (_maxY-_minY+1), MPI::DOUBLE, MPI::SUM, 0, _ranks.communicator(), &mapReductions[k]);
+    }
 
     vector<int>newPlace={0,0};
-    for (auto& m:movers){
-        newPlace[0]=int(m->_destination[0]);
-        newPlace[1]=int(m->_destination[1]);
-        //move things - these are then settled
-        space()->moveTo(m,newPlace);
-    }
+    for (auto& t:movers){
+        for (auto& m:t){
+            newPlace[0]=int(m->_destination[0]);
+            newPlace[1]=int(m->_destination[1]);
+            //move things - these are then settled
+            moveAgent(m,newPlace);
+        }
     }
     // ***** state of the model will not be fully consistent until sync() *****
  
@@ -596,7 +699,8 @@ bool _cellBased=true;//cell based may be al lot faster if there are significant
     if (_output){
 
      //also get the maps
-     for (auto name:outputNames)MPI_Reduce(localMaps[name].data(), outputMaps[name].data(), (_maxX-_minX+1) * (_maxY-_minY+1), MPI::DOUBLE, MPI::SUM, 0, MPI_COMM_WORLD);
+     if (_overlapHalo)MPI_Waitall(mapReductions.size(), mapReductions.data(), MPI_STATUSES_IGNORE);
+     else for (auto name:outputNames)MPI_Reduce(localMaps[name].data(), outputMaps[name].data(), (_maxX-_minX+1) * (_maxY-_minY+1), MPI::DOUBLE, MPI::SUM, 0, MPI_COMM_WORLD);
 
      if(repast::RepastProcess::instance()->rank() == 0){netcdfOutput( CurrentTimeStep - _startingStep + 1);}
     }
@@ -606,6 +710,161 @@ bool _cellBased=true;//cell based may be al lot faster if there are significant
 }
 
 
+//------------------------------------------------------------------------------------------------------------
+//a new human in cell x,y, added to the model
+Human* MadModel::createHuman(int x,int y,randomizer* random,bool withinCell){
+    int rank = repast::RepastProcess::instance()->rank();
+    unsigned hF=10000;//functionalgroup ID for humans
+    EnvironmentCell* E=_Env[x][y];
+    //make sure the agentId is unique on this thread!!
+    // values are int id, int startProc, int agentType, 
+    repast::AgentId id(Human::_NextID, rank, _humanType);
+    //agent also needs id of its current thread
+    id.currentRank(rank);
+    Human* h = new Human(id);
+    h->setup(hF,E->Population(), E,random);
+
+    //to get movement right agent needs its own copy of location
+    double xr=0,yr=0;
+    if (_dispersalSelection=="direct" && withinCell){
+        xr=random->GetUniform();
+        yr=random->GetUniform();
+    }else if (_dispersalSelection=="direct"){
+        //allow cohorts to be at locations other than cell centres initially - note using fractional cell co-ordinates
+        xr=(1-2*random->GetUniform())*0.5;
+        yr=(1-2*random->GetUniform())*0.5;
+        if (y+yr <  _minX)    {yr = -yr;}
+        if (y+yr >= _maxX + 1){yr = -yr;}
+        if (!_noLongitudeWrap){
+            if (x+xr <  _minX)    {xr = xr + (_maxX - _minX + 1);}
+            if (x+xr >= _maxX + 1){xr = xr - (_maxX - _minX + 1);}
+        } else {
+            if (x+xr <  _minX)    {xr = -xr;}
+            if (x+xr >= _maxX + 1){xr = -xr;}
+        }
+    }
+    assert(y+yr >= _minY);
+    repast::Point<int> initialLocation(x+xr,y+yr);
+    //to get movement right agent needs its own copy of location (set first, as it is copied into the cell columns)
+    h->setLocation(x+xr,y+yr);
+    addAgent(h, initialLocation);
+    return h;
+}
+//------------------------------------------------------------------------------------------------------------
+//Infection of pooled susceptibles (see SusceptiblePool) by infectious humans in range of each local cell, including buffer zone copies.
+//Cells are independent so the draws are shared over threads; the humans for those infected are then created one at a time,
+//as adding agents to the model is not thread safe.
+void MadModel::infectPool(int range){
+    struct poolInfection{int x,y;unsigned disease,sex,number;};
+    std::vector< std::vector<poolInfection> > infections(_threads);
+    //counted infectious people can reach across rank boundaries if there is cross-cell interaction
+    if (_hybridCells)_compartments.exchange(range>0 && repast::RepastProcess::instance()->worldSize()>1,_ranks,range);
+    _scheduler.clear();
+    for(int y = _ylo; y < _yhi; y++){
+        for(int x = _xlo; x < _xhi; x++){
+            unsigned pooled=_pool.total(x,y);
+            if (pooled==0) continue;
+            unsigned sources=0;
+            for (int i=-range;i<=range;i++)for (int j=-range;j<=range;j++)sources+=_cells.infectiousAt(x+i,y+j);
+            if (_hybridCells && sources==0 && _compartments.infectiousInRange(x,y,range))sources=1;
+            if (sources>0)_scheduler.add(x,y,sources,sources,false);
+        }
+    }
+    _scheduler.run([&](const CellTask& task){
+        std::map<unsigned,double> logEscape;
+        for (int i=-range;i<=range;i++){
+            for (int j=-range;j<=range;j++){
+                std::vector<MadAgent*>* sources=_cells.cell(task._x+i,task._y+j);
+                if (sources==NULL) continue;
+                for (auto a:*sources) if (a->getId().agentType()==_humanType)_pool.addSource(task._x,task._y,(Human*)a,logEscape);
+            }
+        }
+        if (_hybridCells)_compartments.addSources(task._x,task._y,range,logEscape);
+        bool counted=_hybridCells && !_compartments.isIndividual(task._x,task._y);
+        for (auto& [name,n]:_pool.draw(task._x,task._y,logEscape)){
+            for (unsigned s=0;s<SusceptiblePool::numberOfSexes;s++){
+                if (n[s]==0) continue;
+                //aggregate cells only count covid
+                if (counted && name==DiseaseRegistry::covid)_compartments.infect(task._x,task._y,s,n[s]);
+                else infections[RandomStreams::threadNumber()].push_back({task._x,task._y,name,s,n[s]});
+            }
+        }
+    });
+    RandomRepast random;
+    for (auto& t:infections){
+        for (auto& p:t){
+            for (unsigned k=0;k<p.number;k++){
+                //the pool takes its susceptibles to be spread uniformly over the cell, so the new human is too
+                Human* h=createHuman(p.x,p.y,&random,true);
+                h->_sex='f';
+                if (p.sex==SusceptiblePool::male)h->_sex='m';
+                h->infectWith(p.disease);
+                _cells.refresh(h,columnState(h));
+            }
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+//Switch cells between counts and individual humans (simulation.HybridCells=true). A counted cell is promoted when it has
+//between 1 and simulation.HybridPromoteBelow infections; an individual cell is demoted when it has none, or at least
+//simulation.HybridDemoteAbove. Only humans with nothing but covid are turned into counts - anyone else stays an agent.
+void MadModel::rebalanceCells(const std::vector< std::pair<int,int> >& cells){
+    RandomRepast random;
+    for (auto& [x,y]:cells){
+        unsigned individuals=0;
+        for (auto a:*_cells.cell(x,y)){
+            Human* h=(Human*)a;
+            if (h->_alive && h->hasDisease(DiseaseRegistry::covid) && !h->recoveredFrom(DiseaseRegistry::covid))individuals++;
+        }
+        unsigned total=individuals+_compartments.infected(x,y);
+        if (!_compartments.isIndividual(x,y) && total>0 && total<=_promoteBelow){
+            //the humans get the disease state they would have had if they had been agents all along. Only the infected are promoted:
+            //the recovered can no longer change, so stay as counts (which the outputs include whatever the cell's mode)
+            std::vector<Human*> promoted;
+            for (unsigned s=0;s<SusceptiblePool::numberOfSexes;s++){
+                for (unsigned n=0;n<_compartments.steps();n++){
+                    unsigned& count=_compartments.infectedCount(x,y,n,s);
+                    for (unsigned k=0;k<count;k++){
+                        Human* h=createHuman(x,y,&random,true);
+                        h->_sex='f';
+                        if (s==SusceptiblePool::male)h->_sex='m';
+                        h->infectWith(DiseaseRegistry::covid);
+                        for (unsigned u=0;u<n;u++)h->_diseases[DiseaseRegistry::covid].update();
+                        _cells.refresh(h,columnState(h));
+                        promoted.push_back(h);
+                    }
+                    count=0;
+                }
+            }
+            _compartments.setMode(x,y,CompartmentCells::individual);
+        }else if (_compartments.isIndividual(x,y) && (total==0 || total>=_demoteAbove)){
+            //copy the list, as removal changes the contents of the cell
+            std::vector<MadAgent*> agentsInCell=*_cells.cell(x,y);
+            for (auto a:agentsInCell){
+                Human* h=(Human*)a;
+                if (!h->_alive) continue;
+                if (h->numberOfDiseases()==0){
+                    _pool.count(x,y,(h->_sex=='m') ? SusceptiblePool::male : SusceptiblePool::female)++;
+                    removeAgent(h);
+                }else if (h->numberOfDiseases()==1 && h->hasDisease(DiseaseRegistry::covid)){
+                    _compartments.add(x,y,h);
+                    removeAgent(h);
+                }
+            }
+            _compartments.setMode(x,y,CompartmentCells::aggregate);
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+//totals are counted in agents (or pooled counts) - convert to people
+void MadModel::scaleTotals(){
+    if (_agentWeight==1) return;
+    _totalSusceptible=round(_totalSusceptible*_agentWeight);
+    _totalInfected   =round(_totalInfected   *_agentWeight);
+    _totalRecovered  =round(_totalRecovered  *_agentWeight);
+    _totalDied       =round(_totalDied       *_agentWeight);
+    _totalPopulation =round(_totalPopulation *_agentWeight);
+}
 //------------------------------------------------------------------------------------------------------------
 void MadModel::sync(){
     //These lines synchronize the agents across all threads - if there is more than one...
@@ -613,23 +872,204 @@ void MadModel::sync(){
     //Possibilites for sync in terms of where to send agents are POLL, USE_CURRENT, USE_LAST_OR_CURRENT, USE_LAST_OR_POLL
     //USE_CURRENT assumes agents do not move beyond the neighbours in the cartesian grid of threads. This fails
     //for some long distance moves - POLL seems the safest (not sure if guaranteed to work though...also maybe slower)
+    //With simulation.Migration=neighbours, USE_CURRENT is used unless some rank has seen a move beyond its neighbours (see checkMigration),
+    //which costs one reduction of a flag rather than POLL's exchange between every pair of ranks
+    RepastProcess::EXCHANGE_PATTERN pattern=RepastProcess::POLL;
+    if (_neighbourMigration){
+        int longJump=_longJump,anyLongJump=0;
+        MPI_Allreduce(&longJump, &anyLongJump, 1, MPI::INT, MPI::MAX, MPI_COMM_WORLD);
+        if (anyLongJump)_pollFallbacks++; else pattern=RepastProcess::USE_CURRENT;
+        _longJump=false;
+    }
 	discreteSpace->balance();
+    receiver->recordArrivals(true);
     repast::RepastProcess::instance()->synchronizeAgentStatus<MadAgent, AgentPackage, 
-             MadAgentPackageProvider, MadAgentPackageReceiver>(_context, *provider, *receiver, *receiver,RepastProcess::POLL);
+             MadAgentPackageProvider, MadAgentPackageReceiver>(_context, *provider, *receiver, *receiver,pattern);
+    receiver->recordArrivals(false);
     
     repast::RepastProcess::instance()->synchronizeProjectionInfo<MadAgent, AgentPackage, 
-             MadAgentPackageProvider, MadAgentPackageReceiver>(_context, *provider, *receiver, *receiver,RepastProcess::POLL);
+             MadAgentPackageProvider, MadAgentPackageReceiver>(_context, *provider, *receiver, *receiver,pattern);
 
+    synchronizeStates();
+
+    updateCellIndex();
+             
+}
+//------------------------------------------------------------------------------------------------------------
+//Buffer zone copies are brought up to date with only the humans, and fields, that have changed since the last call (see Human::_dirty),
+//except every simulation.GhostRefreshInterval calls when everything is sent, in case a change was not marked
+void MadModel::synchronizeStates(){
+    provider->fullRefresh(startStateSync());
 	repast::RepastProcess::instance()->synchronizeAgentStates<AgentPackage, 
              MadAgentPackageProvider, MadAgentPackageReceiver>(*provider, *receiver);
-             
+    provider->fullRefresh(true);
+    finishStateSync();
+}
+//------------------------------------------------------------------------------------------------------------
+//true if this state sync should send everything
+bool MadModel::startStateSync(){
+    return _stateSyncs%_ghostRefreshInterval==0;
+}
+//------------------------------------------------------------------------------------------------------------
+//changes have now been sent
+void MadModel::finishStateSync(){
+    _stateSyncs++;
+    for (auto& [x,y]:_localCells){
+        for (auto a:*_cells.cell(x,y))if (a->getId().agentType()==_humanType)((Human*)a)->_dirty=0;
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+// Keeping the cell index up to date
+//------------------------------------------------------------------------------------------------------------
+void MadModel::addAgent(MadAgent* a,const repast::Point<int>& location){
+    _context.addAgent(a);
+    discreteSpace->moveTo(a->getId(), location);
+    //agents placed outside the local grid will leave this thread at the next sync
+    if (_cells.isLocal(location.getX(),location.getY())){
+        _cells.add(a,location.getX(),location.getY(),columnState(a));
+    }else checkMigration(location.getX(),location.getY());
+}
+//------------------------------------------------------------------------------------------------------------
+void MadModel::removeAgent(MadAgent* a){
+    _cells.remove(a);
+    _context.removeAgent(a->getId());
+}
+//------------------------------------------------------------------------------------------------------------
+void MadModel::moveAgent(MadAgent* a,const std::vector<int>& location){
+    space()->moveTo(a,location);
+    if (_cells.isLocal(location[0],location[1])) _cells.move(a,location[0],location[1],columnState(a));
+    else {_cells.remove(a);checkMigration(location[0],location[1]);}
+}
+//------------------------------------------------------------------------------------------------------------
+//an agent is leaving this rank for cell x,y - note if it is going further than a neighbouring rank
+//NB agents moved directly in the repast space (rather than with moveAgent or addAgent) are not checked
+void MadModel::checkMigration(int x,int y){
+    if (_neighbourMigration && !_longJump && !_ranks.isNeighbour(x,y))_longJump=true;
+}
+//------------------------------------------------------------------------------------------------------------
+uint8_t MadModel::columnState(MadAgent* a){
+    uint8_t state=0;
+    if (a->_alive)state|=CellColumns::alive;
+    if (a->getId().agentType()!=_humanType) return state;
+    Human* h=(Human*)a;
+    if (a->getId().currentRank()==repast::RepastProcess::instance()->rank())state|=CellColumns::localHuman;
+    if (!h->hasDisease(DiseaseRegistry::covid))state|=CellColumns::susceptible;
+    if (h->recoveredFrom(DiseaseRegistry::covid))state|=CellColumns::recovered;
+    if (h->isInfectious())state|=CellColumns::infectious;
+    return state;
+}
+//------------------------------------------------------------------------------------------------------------
+void MadModel::updateCellIndex(){
+    int rank=repast::RepastProcess::instance()->rank();
+    //buffer zone copies are created and destroyed by repast during sync, so the halo is simply rebuilt
+    //NB pointers left in the halo may now be dangling, so clear it before anything else
+    _cells.clearHalo();
+    //agents that have migrated to this thread - either new or previously held as a buffer zone copy
+    for (auto& id:receiver->received()){
+        if (_context.contains(id)){
+            MadAgent* a=_context.getAgent(id);
+            if (a->getId().currentRank()==rank && !_cells.contains(a)){
+                _cells.add(a,int(a->_location[0]),int(a->_location[1]),columnState(a));
+            }
+        }
+    }
+    receiver->received().clear();
+    if (_cells.hasHalo() && !_infectiousHalo){
+        std::vector<MadAgent*> copies;
+        _context.selectAgents(repast::SharedContext<MadAgent>::NON_LOCAL,copies);
+        for (auto a:copies){
+            _cells.add(a,int(a->_location[0]),int(a->_location[1]),columnState(a));
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+void MadModel::rebuildCellIndex(){
+    //NB pointers in the index may be dangling, so nothing in it is looked at before it is emptied
+    _cells.clear();
+    std::vector<MadAgent*> agents;
+    _context.selectAgents(repast::SharedContext<MadAgent>::LOCAL,agents);
+    std::vector<int> location;
+    for (auto a:agents){
+        space()->getLocation(a->getId(),location);
+        if (_cells.isLocal(location[0],location[1]))_cells.add(a,location[0],location[1],columnState(a));
+    }
+    updateCellIndex();
+}
+//------------------------------------------------------------------------------------------------------------
+//With simulation.InfectiousHalo=true there are no buffer zone copies - instead the halo of _cells is filled with stand-in humans
+//made from the records for infectious humans near the edges of neighbouring ranks. The interaction passes treat them as they would
+//buffer zone copies: they infect local humans in range, but are never candidates themselves (they are not local).
+//Stand-ins are not in the repast context, and are reused from one timestep to the next.
+void MadModel::updateStandIns(){
+    _halo.startInfectious(_cells);
+    const std::vector<InfectiousRecord>& records=_halo.finishInfectious();
+    _cells.clearHalo();
+    while (_standIns.size()<records.size()){
+        //not a real agent: starting and current rank -1, so never local; made from a package so that _NextID is unchanged
+        repast::AgentId id(_standIns.size(), -1, _humanType, -1);
+        _standIns.push_back(new Human(id,AgentPackage(id)));
+    }
+    for (unsigned k=0;k<records.size();k++){
+        Human* h=_standIns[k];
+        h->standInFor(records[k]._location,records[k]._diseases);
+        _cells.add(h,int(h->_location[0]),int(h->_location[1]),columnState(h));
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+//The interaction pass only needs cells where something can be passed on. With pairwise interaction these are cells holding an infectious
+//human (local or a buffer zone copy), which then interacts with susceptibles in its neighbourhood; with force of infection they are local cells with
+//an infectious human in range. Early and late in an epidemic this is a small fraction of the grid, so rather than rescanning every cell
+//each timestep, _cells keeps both sets up to date from the cells whose infectious count has moved between zero and non-zero.
+//Active cells are grouped by colour: pairwise interaction changes humans anywhere in the range of a cell, so cells processed at the same time
+//(on different threads) must be more than 2*range apart. Force of infection only changes humans in the cell being processed,
+//and reads the humans in range through the sources taken beforehand (takeSources), so needs one colour.
+void MadModel::findActiveCells(int range){
+    int period=1;
+    if (!_forceOfInfection)period=2*range+1;
+    _activeCells.assign(4*period*period,std::vector< std::pair<int,int> >());
+    _cells.updateInfectious(range);
+    int x,y;
+    if (_forceOfInfection){
+        for (int b:_cells.inRangeBuckets()){_cells.coordinates(b,x,y);_activeCells[0].push_back({x,y});}
+    }else{
+        for (int b:_cells.infectiousBuckets()){
+            _cells.coordinates(b,x,y);
+            if (x>=_xlo-range && x<_xhi+range && y>=_ylo-range && y<_yhi+range && x>= _minX && x<=_maxX && y>= _minY && y<=_maxY){
+                int colour=colourOf(x-_minX,_maxX-_minX+1,period)+2*period*colourOf(y-_minY,_maxY-_minY+1,period);
+                _activeCells[colour].push_back({x,y});
+            }
+        }
+    }
+    //the sets are in no particular order - sort so that the tasks are dealt the same way as from a scan of the grid
+    for (auto& colour:_activeCells)std::sort(colour.begin(),colour.end());
+}
+//------------------------------------------------------------------------------------------------------------
+//copy the infection pressure of every infectious human in _cells (local or buffer zone) into _sources, bucket by bucket
+//(only the buckets filled last time need emptying - findActiveCells has already brought the infectious buckets up to date)
+void MadModel::takeSources(){
+    _sources.resize(_cells.numberOfBuckets());
+    for (int b:_sourceBuckets)_sources[b].clear();
+    _sourceBuckets=_cells.infectiousBuckets();
+    for (int b:_sourceBuckets){
+        std::vector<MadAgent*>& agents=_cells.bucket(b);
+        const CellColumns& columns=_cells.columns(b);
+        for (unsigned k=0;k<agents.size();k++) if (columns.has(k,CellColumns::infectious))_foi[0].sourcesOf((Human*)agents[k],_sources[b]);
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+//colour of a row or column i out of n, repeating with the given period. The grid wraps, so if n is not a multiple of period
+//the left over rows at the end each get a colour of their own to keep them apart from the start of the grid.
+int MadModel::colourOf(int i,int n,int period){
+    int full=(n/period)*period;
+    if (i<full) return i%period;
+    return period+i-full;
 }
 //------------------------------------------------------------------------------------------------------------
 // Packages for exchanging agents across threads
 //------------------------------------------------------------------------------------------------------------
 
 
-MadAgentPackageProvider::MadAgentPackageProvider(repast::SharedContext<MadAgent>* agentPtr): agents(agentPtr){ }
+MadAgentPackageProvider::MadAgentPackageProvider(repast::SharedContext<MadAgent>* agentPtr): agents(agentPtr),_fullRefresh(true){ }
 //------------------------------------------------------------------------------------------------------------
 
 void MadAgentPackageProvider::providePackage(MadAgent* agent, std::vector<AgentPackage>& out){
@@ -643,22 +1083,30 @@ void MadAgentPackageProvider::providePackage(MadAgent* agent, std::vector<AgentP
 
 //------------------------------------------------------------------------------------------------------------
 
+//ghost updates - humans that have not changed since the last update are left out, and the rest only send the fields that have changed
 void MadAgentPackageProvider::provideContent(repast::AgentRequest req, std::vector<AgentPackage>& out){
     std::vector<repast::AgentId> ids = req.requestedAgents();
     for(size_t i = 0; i < ids.size(); i++){
-        providePackage(agents->getAgent(ids[i]), out);
+        MadAgent* agent=agents->getAgent(ids[i]);
+        if (_fullRefresh || agent->getId().agentType() != MadModel::_humanType){providePackage(agent, out);continue;}
+        Human* h=(Human*)agent;
+        if (h->_dirty==0) continue;
+        AgentPackage package(ids[i]);
+        h->PushThingsIntoPackage(package,h->_dirty);
+        out.push_back(package);
     }
 }
 //------------------------------------------------------------------------------------------------------------
 
 
-MadAgentPackageReceiver::MadAgentPackageReceiver(repast::SharedContext<MadAgent>* agentPtr): agents(agentPtr){}
+MadAgentPackageReceiver::MadAgentPackageReceiver(repast::SharedContext<MadAgent>* agentPtr): agents(agentPtr),_recordArrivals(false){}
 //------------------------------------------------------------------------------------------------------------
 
-MadAgent * MadAgentPackageReceiver::createAgent(AgentPackage package){
+MadAgent * MadAgentPackageReceiver::createAgent(const AgentPackage& package){
     repast::AgentId id=package.getId();
     if (id.agentType() == MadModel::_humanType){
         Human* c=new Human(id,package);
+        if (_recordArrivals)_received.push_back(id);
         return c;
     } else {
         return 0;
@@ -666,11 +1114,13 @@ MadAgent * MadAgentPackageReceiver::createAgent(AgentPackage package){
 }
 //------------------------------------------------------------------------------------------------------------
 //This function is needed if buffers are being used so that agents can interact across cells
-void MadAgentPackageReceiver::updateAgent(AgentPackage package){
+void MadAgentPackageReceiver::updateAgent(const AgentPackage& package){
     repast::AgentId id=package.getId();
     if (id.agentType() == MadModel::_humanType){
       Human* agent = (Human*)(agents->getAgent(id));//I think this matches irrespective of the value of currentRank (AgentId== operator doesn't use it)
       agent->PullThingsOutofPackage(package);
+      //buffer zone copies become local if the original moves here
+      if (_recordArrivals)_received.push_back(id);
     }
 }
 //------------------------------------------------------------------------------------------------------------
@@ -772,6 +1222,73 @@ void MadModel::dataSetClose() {
 	}
 }
 //---------------------------------------------------------------------------------------------------------------------------
+//time each thread spent on cell tasks in step(), gathered from all ranks - if the scheduler is doing its job the busy times
+//on a rank should be close to each other. Printed by rank 0 (when there is more than one thread) and saved in RunParameters.
+void MadModel::reportThreadLoad() {
+    int rank=repast::RepastProcess::instance()->rank();
+    int ranks=repast::RepastProcess::instance()->worldSize();
+    std::vector<double> busy=_scheduler.busyTime();
+    std::vector<double> all(busy.size()*ranks,0.);
+    MPI_Gather(busy.data(), busy.size(), MPI::DOUBLE, all.data(), busy.size(), MPI::DOUBLE, 0, MPI_COMM_WORLD);
+    if (rank==0){
+        double maxBusy=0,meanBusy=0;
+        for (auto b:all){maxBusy=std::max(maxBusy,b);meanBusy+=b/all.size();}
+        if (_threads>1){
+            for (int r=0;r<ranks;r++){
+                cout<<"Thread busy time (s) rank "<<r<<":";
+                for (unsigned t=0;t<_threads;t++)cout<<" "<<all[r*_threads+t];
+                cout<<endl;
+            }
+            if (meanBusy>0)cout<<"Thread busy time max/mean "<<maxBusy/meanBusy<<endl;
+        }
+        _props->putProperty("run.thread.busy.max", maxBusy);
+        _props->putProperty("run.thread.busy.mean", meanBusy);
+        //the same on every rank - number of syncs that could not use neighbour-only migration
+        if (_neighbourMigration)_props->putProperty("run.migration.pollFallbacks", _pollFallbacks);
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------------
+//Memory held on each rank once the configured population has been made (simulation.MemoryReport=true), maximum over ranks.
+//Measured from what is actually allocated: the human slabs (whole slabs, free blocks included - their size per human is the cost of
+//the object with its inline diseases and positions), the cell index buckets and columns, and the susceptible pool and compartment counts,
+//all including unused vector capacity. Buffer zone copies are humans in the slabs too, and are counted as they stand (none with InfectiousHalo).
+//The per-agent bookkeeping inside repast (context map entry and shared_ptr control block, grid location entries) cannot be reached,
+//so is only estimated from node sizes - it is printed as an estimate and left out of the budget check.
+//If simulation.MemoryBudgetMB is set and the measured total for any rank is over it, the run stops. The peak can still grow later
+//(births, pooled susceptibles becoming humans as they are infected), which the report does not try to project.
+void MadModel::memoryReport() {
+    int rank=repast::RepastProcess::instance()->rank();
+    std::vector<MadAgent*> agents,copies;
+    _context.selectAgents(repast::SharedContext<MadAgent>::LOCAL,agents);
+    if (_cells.hasHalo() && !_infectiousHalo)_context.selectAgents(repast::SharedContext<MadAgent>::NON_LOCAL,copies);
+    const double node=4*sizeof(void*);//red-black tree node links and colour, roughly
+    double repastPerAgent=node+sizeof(repast::AgentId)+2*sizeof(void*)+4*sizeof(void*)//map entry with the shared_ptr, plus its control block
+                         +2*(node+sizeof(repast::AgentId)+sizeof(void*))+2*sizeof(int);//agent to location and location to agents entries
+    //measured humans, cell index, pool, compartments; estimated repast bookkeeping; buffer zone copies as a fraction of local humans
+    double local[6]={double(Human::_Pool.bytes()),double(_cells.bytes()),double(_pool.bytes()),double(_compartments.bytes()),
+                     repastPerAgent*(agents.size()+copies.size()),agents.empty() ? 0. : double(copies.size())/agents.size()};
+    double measured=local[0]+local[1]+local[2]+local[3];
+    double maxima[6],maxMeasured=0;
+    MPI_Allreduce(local, maxima, 6, MPI::DOUBLE, MPI::MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(&measured, &maxMeasured, 1, MPI::DOUBLE, MPI::MAX, MPI_COMM_WORLD);
+    if (rank==0){
+        cout<<"Memory per rank after initialisation, max over ranks (MB): humans "<<maxima[0]/1.e6<<" ("<<Human::_Pool.blockSize()<<" bytes each)"
+            <<" cell index "<<maxima[1]/1.e6<<" susceptible pool "<<maxima[2]/1.e6<<" compartments "<<maxima[3]/1.e6
+            <<" - measured total "<<maxMeasured/1.e6<<endl;
+        cout<<"Estimated, not measured: repast bookkeeping "<<repastPerAgent<<" bytes per agent, "<<maxima[4]/1.e6<<" MB"<<endl;
+        cout<<"Buffer zone copies: up to "<<maxima[5]*100<<"% extra humans per rank"<<endl;
+        _props->putProperty("run.memory.bytesPerHuman", Human::_Pool.blockSize());
+        _props->putProperty("run.memory.measuredMB", maxMeasured/1.e6);
+        _props->putProperty("run.memory.repastEstimateMB", maxima[4]/1.e6);
+    }
+    std::string budget=_props->getProperty("simulation.MemoryBudgetMB");
+    if (budget!="" && maxMeasured/1.e6>repast::strToDouble(budget)){
+        if (rank==0)cout<<"Measured memory ("<<maxMeasured/1.e6<<" MB) is over simulation.MemoryBudgetMB ("<<budget<<" MB)"<<endl;
+        MPI_Finalize();
+        exit(1);
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------------
 void MadModel::addDataSet(repast::DataSet* dataSet) {
 	dataSets.push_back(dataSet);
 	ScheduleRunner& runner = RepastProcess::instance()->getScheduleRunner();
@@ -805,13 +1322,15 @@ void MadModel::addDataSet(repast::DataSet* dataSet) {
           }
       }
       
-      if (_archiveFormat =="binary") {boost::archive::binary_oarchive oa(ofs);oa<<_packages;}
-      if (_archiveFormat =="text"  ) {boost::archive::text_oarchive   oa(ofs);oa<<_packages;}
+      if (_archiveFormat =="binary") {boost::archive::binary_oarchive oa(ofs);oa<<restartFormat<<_packages;}
+      if (_archiveFormat =="text"  ) {boost::archive::text_oarchive   oa(ofs);oa<<restartFormat<<_packages;}
      
       
       if (_verbose) cout<<"Wrote "<<_packages.size()<<" objects to restart: "<<"Restart_step_rank_"<<s.str()<<endl;
      }
      _packages.clear();
+     if (_lazySusceptibles)writePoolRestart(step);
+     if (_hybridCells)writeCompartmentRestart(step);
 
      
  }
@@ -842,8 +1361,13 @@ void MadModel::read_restart(unsigned step){
                 std::ifstream ifs(filename);
                 {// this block ensures the archive gets closed on block exit
                     try {
-                        if (_archiveFormat =="binary"){boost::archive::binary_iarchive ia(ifs);ia>>_packages;}
-                        if (_archiveFormat =="text"  ){boost::archive::text_iarchive   ia(ifs);ia>>_packages;}
+                        unsigned format=0;
+                        if (_archiveFormat =="binary"){boost::archive::binary_iarchive ia(ifs);ia>>format;if (format==restartFormat)ia>>_packages;}
+                        if (_archiveFormat =="text"  ){boost::archive::text_iarchive   ia(ifs);ia>>format;if (format==restartFormat)ia>>_packages;}
+                        if (format!=restartFormat){
+                            cout<<"Restart file "<<filename<<" was written by an incompatible version of the model and cannot be read"<<endl;
+                            error=1;
+                        }
                         
                         cout<<"Read in "<<_packages.size()<<" mad agents..."<<endl;
                         for (auto& p:_packages){
@@ -862,9 +1386,8 @@ void MadModel::read_restart(unsigned step){
                                 //number of threads may have decreased so check to be sure we don't overflow nxtID
                                 if (a->getId().startingRank()<numProcs)
                                     nxtID[a->getId().startingRank()]=max<int>(a->getId().id()+1,nxtID[a->getId().startingRank()]);
-                                _context.addAgent(a);
                                 repast::Point<int> initialLocation(int(a->getLocation()[0]),int(a->getLocation()[1]));
-                                space()->moveTo(id, initialLocation);
+                                addAgent(a, initialLocation);
                             }else{ cout<<"Warning NULL agents on reading restart file "<<filename<<endl;}
                         }
                         _packages.clear();
@@ -877,6 +1400,7 @@ void MadModel::read_restart(unsigned step){
             
             //check for errors
             MPI_Bcast(&error, 1, MPI_INT, 0 , MPI_COMM_WORLD);
+            if (error!=0)break;
             //sync so thread 0 doesn't have to carry all the agents from a possibly multi-core previous run
             //remember every thread needs to do the sync, not just thread 0!
             sync();
@@ -899,6 +1423,129 @@ void MadModel::read_restart(unsigned step){
             exit(error);
     }
 }
+//------------------------------------------------------------------------------------------------------------
+//pooled susceptibles are saved as x,y,female count,male count for each non-empty local cell
+void MadModel::writePoolRestart(unsigned step){
+    std::vector<int> counts;
+    for(int y = _ylo; y < _yhi; y++){
+        for(int x = _xlo; x < _xhi; x++){
+            if (_pool.total(x,y)>0){
+                counts.push_back(x);counts.push_back(y);
+                counts.push_back(_pool.count(x,y,SusceptiblePool::female));
+                counts.push_back(_pool.count(x,y,SusceptiblePool::male));
+            }
+        }
+    }
+    std::stringstream s;
+    s<<step<<"_"<<repast::RepastProcess::instance()->rank();
+    std::ofstream ofs(_filePrefix+"SusceptiblePool_step_rank_"+s.str());
+    unsigned format=SusceptiblePool::restartFormat;
+    if (_archiveFormat =="binary") {boost::archive::binary_oarchive oa(ofs);oa<<format<<counts;}
+    if (_archiveFormat =="text"  ) {boost::archive::text_oarchive   oa(ofs);oa<<format<<counts;}
+}
+//------------------------------------------------------------------------------------------------------------
+//counted cells are saved as x,y,mode, then the infected counts by steps since infection and sex, then recovered by sex
+void MadModel::writeCompartmentRestart(unsigned step){
+    std::vector<int> counts;
+    for(int y = _ylo; y < _yhi; y++){
+        for(int x = _xlo; x < _xhi; x++){
+            counts.push_back(x);counts.push_back(y);counts.push_back(_compartments.isIndividual(x,y));
+            for (unsigned n=0;n<_compartments.steps();n++)for (unsigned s=0;s<SusceptiblePool::numberOfSexes;s++)counts.push_back(_compartments.infectedCount(x,y,n,s));
+            for (unsigned s=0;s<SusceptiblePool::numberOfSexes;s++)counts.push_back(_compartments.recoveredCount(x,y,s));
+        }
+    }
+    std::stringstream s;
+    s<<step<<"_"<<repast::RepastProcess::instance()->rank();
+    std::ofstream ofs(_filePrefix+"Compartments_step_rank_"+s.str());
+    unsigned format=CompartmentCells::restartFormat;
+    if (_archiveFormat =="binary") {boost::archive::binary_oarchive oa(ofs);oa<<format<<counts;}
+    if (_archiveFormat =="text"  ) {boost::archive::text_oarchive   oa(ofs);oa<<format<<counts;}
+}
+//------------------------------------------------------------------------------------------------------------
+void MadModel::readCompartmentRestart(unsigned step){
+    _compartments.clear();
+    unsigned r=0;
+    unsigned record=3+(_compartments.steps()+1)*SusceptiblePool::numberOfSexes;
+    std::stringstream s;
+    s<<step<<"_"<<r;
+    std::string filename=_restartDirectory+"Compartments_step_rank_"+s.str();
+    if (!boost::filesystem::exists(filename)){
+        if (repast::RepastProcess::instance()->rank()==0)cout<<"No compartment restarts found for "<<filename<<endl;
+        MPI_Finalize();
+        exit(1);
+    }
+    while(boost::filesystem::exists(filename)){
+        std::vector<int> counts;
+        std::ifstream ifs(filename);
+        unsigned format=0;
+        {
+            if (_archiveFormat =="binary"){boost::archive::binary_iarchive ia(ifs);ia>>format;if (format==CompartmentCells::restartFormat)ia>>counts;}
+            if (_archiveFormat =="text"  ){boost::archive::text_iarchive   ia(ifs);ia>>format;if (format==CompartmentCells::restartFormat)ia>>counts;}
+        }
+        if (format!=CompartmentCells::restartFormat){
+            cout<<"Compartment restart "<<filename<<" was written by an incompatible version of the model and cannot be read"<<endl;
+            MPI_Finalize();
+            exit(1);
+        }
+        if (counts.size()%record!=0){
+            cout<<"Compartment restart "<<filename<<" does not match the disease time course of this run"<<endl;
+            MPI_Finalize();
+            exit(1);
+        }
+        for (size_t i=0;i<counts.size();i+=record){
+            int x=counts[i],y=counts[i+1];
+            if (x>=_xlo && x<_xhi && y>=_ylo && y<_yhi){
+                if (counts[i+2])_compartments.setMode(x,y,CompartmentCells::individual);
+                unsigned k=i+3;
+                for (unsigned n=0;n<_compartments.steps();n++)for (unsigned s=0;s<SusceptiblePool::numberOfSexes;s++)_compartments.infectedCount(x,y,n,s)=counts[k++];
+                for (unsigned s=0;s<SusceptiblePool::numberOfSexes;s++)_compartments.recoveredCount(x,y,s)=counts[k++];
+            }
+        }
+        r++;
+        std::stringstream s;
+        s<<step<<"_"<<r;
+        filename=_restartDirectory+"Compartments_step_rank_"+s.str();
+    }
+}
+//------------------------------------------------------------------------------------------------------------
+//every rank reads all the pool files from the previous run (which may have had a different number of ranks) and keeps its own cells
+void MadModel::readPoolRestart(unsigned step){
+    _pool.clear();
+    unsigned r=0;
+    std::stringstream s;
+    s<<step<<"_"<<r;
+    std::string filename=_restartDirectory+"SusceptiblePool_step_rank_"+s.str();
+    if (!boost::filesystem::exists(filename)){
+        if (repast::RepastProcess::instance()->rank()==0)cout<<"No susceptible pool restarts found for "<<filename<<endl;
+        MPI_Finalize();
+        exit(1);
+    }
+    while(boost::filesystem::exists(filename)){
+        std::vector<int> counts;
+        std::ifstream ifs(filename);
+        unsigned format=0;
+        {
+            if (_archiveFormat =="binary"){boost::archive::binary_iarchive ia(ifs);ia>>format;if (format==SusceptiblePool::restartFormat)ia>>counts;}
+            if (_archiveFormat =="text"  ){boost::archive::text_iarchive   ia(ifs);ia>>format;if (format==SusceptiblePool::restartFormat)ia>>counts;}
+        }
+        if (format!=SusceptiblePool::restartFormat){
+            cout<<"Susceptible pool restart "<<filename<<" was written by an incompatible version of the model and cannot be read"<<endl;
+            MPI_Finalize();
+            exit(1);
+        }
+        for (size_t i=0;i+3<counts.size();i+=4){
+            int x=counts[i],y=counts[i+1];
+            if (x>=_xlo && x<_xhi && y>=_ylo && y<_yhi){
+                _pool.count(x,y,SusceptiblePool::female)+=counts[i+2];
+                _pool.count(x,y,SusceptiblePool::male  )+=counts[i+3];
+            }
+        }
+        r++;
+        std::stringstream s;
+        s<<step<<"_"<<r;
+        filename=_restartDirectory+"SusceptiblePool_step_rank_"+s.str();
+    }
+}
 //---------------------------------------------------------------------------------------------------------------------------
 //---------------------------------------------------------------------------------------------------------------------------
 //***------------------------------------------------TESTING Section----------------------------------------------------***//
@@ -922,6 +1569,9 @@ void MadModel::tests(){
     repast::Point<int> initialLocation(x,y);
     repast::Point<int> origin(_minX,_minY);
     EnvironmentCell* E=_Env[x][y];
+    //the earlier tests move agents around directly in the repast space, so may make long jumps unseen by checkMigration
+    bool neighbourMigration=_neighbourMigration;
+    _neighbourMigration=false;
     
     //---------------------------------------------------
     //***-------------------TEST 1-------------------***//
@@ -1299,7 +1949,7 @@ void MadModel::tests(){
          //Human::_NextID should be incremented here so set increase flag to true
          MadAgent* a=new Human( id,p,true );
          assert(Human::_NextID==n+1);
-         assert(a->getId()==p._id);
+         assert(a->getId()==p.getId());
          assert(a->getId().currentRank()==rank);
          assert(a->getId().agentType()==_humanType);
          checkHumanTestValues((Human*)a);
@@ -1307,6 +1957,416 @@ void MadModel::tests(){
      }
      if (rank==0)cout<<"Test 12 : succeeded"<<endl;
 
+    //---------------------------------------------------
+    //***-------------------TEST 13-------------------***//
+    //---------------------------------------------------
+    //pairwise and force of infection interaction should give statistically the same number of new infections in a cell
+    if (rank==0)cout<<"Test13: compare pairwise and force of infection interaction"<<endl;
+    {
+     int nInfectious=5,nSusceptible=200,trials=200;
+     std::vector<Human*> infectious,susceptible;
+     for (int i=0;i<nInfectious+nSusceptible;i++){
+        repast::AgentId id(Human::_NextID, rank, _humanType);
+        id.currentRank(rank);
+        Human* c = new Human(id);
+        c->setup(0,1, E,random);
+        c->setLocation(x+random->GetUniform(),y+random->GetUniform());
+        if (i<nInfectious){c->infectWith("covid");c->diseaseState("covid").becomeInfectious();infectious.push_back(c);}
+        else susceptible.push_back(c);
+     }
+     double p=infectious[0]->diseaseState("covid").infectionProb();
+     double expected=nSusceptible*(1.-pow(1.-p,nInfectious*_agentWeight));
+     double pairwise=0,foi=0;
+     for (int t=0;t<trials;t++){
+        for (auto s:susceptible)s->clearDiseases();
+        for (auto i:infectious)i->interact(susceptible,this);
+        for (auto s:susceptible)if (s->hasDisease("covid"))pairwise++;
+        for (auto s:susceptible)s->clearDiseases();
+        _foi[0].reset(x,y);
+        for (auto i:infectious)_foi[0].addSource(i);
+        for (auto s:susceptible)_foi[0].infect(s);
+        for (auto s:susceptible)if (s->hasDisease("covid"))foi++;
+     }
+     pairwise/=trials;foi/=trials;
+     //allow five standard errors of the mean
+     double tolerance=5*sqrt(expected*(1.-expected/nSusceptible)/trials);
+     cout<<"Test13: rank "<<rank<<" expected "<<expected<<" pairwise "<<pairwise<<" force of infection "<<foi<<endl;
+     assert(fabs(pairwise-expected)<tolerance);
+     assert(fabs(foi-expected)<tolerance);
+     for (auto i:infectious)delete i;
+     for (auto s:susceptible)delete s;
+    }
+    if (rank==0)cout<<"Test13 succeeded"<<endl;
+
+    //---------------------------------------------------
+    //***-------------------TEST 14-------------------***//
+    //---------------------------------------------------
+    //pooled susceptibles with infectious humans near the centre of their cell should be infected as often as individual ones,
+    //and the number infected should come out of the pool
+    if (rank==0)cout<<"Test14: infection of pooled susceptibles"<<endl;
+    {
+     int nInfectious=5,nSusceptible=200,trials=200;
+     std::vector<Human*> infectious;
+     for (int i=0;i<nInfectious;i++){
+        repast::AgentId id(Human::_NextID, rank, _humanType);
+        id.currentRank(rank);
+        Human* c = new Human(id);
+        c->setup(0,1, E,random);
+        c->setLocation(x+0.25+0.5*random->GetUniform(),y+0.25+0.5*random->GetUniform());
+        c->infectWith("covid");c->diseaseState("covid").becomeInfectious();infectious.push_back(c);
+     }
+     double p=infectious[0]->diseaseState("covid").infectionProb();
+     double expected=nSusceptible*(1.-pow(1.-p,nInfectious*_agentWeight));
+     double pooled=0;
+     _pool.clear();
+     for (int t=0;t<trials;t++){
+        _pool.count(x,y,SusceptiblePool::female)=nSusceptible/2;
+        _pool.count(x,y,SusceptiblePool::male  )=nSusceptible-nSusceptible/2;
+        std::map<unsigned,double> logEscape;
+        for (auto i:infectious)_pool.addSource(x,y,i,logEscape);
+        unsigned n=0;
+        for (auto& [name,c]:_pool.draw(x,y,logEscape)){assert(name==DiseaseRegistry::covid);n+=c[SusceptiblePool::female]+c[SusceptiblePool::male];}
+        assert(_pool.total(x,y)==nSusceptible-n);
+        pooled+=n;
+     }
+     pooled/=trials;
+     double tolerance=5*sqrt(expected*(1.-expected/nSusceptible)/trials);
+     cout<<"Test14: rank "<<rank<<" expected "<<expected<<" pooled "<<pooled<<endl;
+     assert(fabs(pooled-expected)<tolerance);
+     _pool.clear();
+     for (auto i:infectious)delete i;
+    }
+    if (rank==0)cout<<"Test14 succeeded"<<endl;
+
+    //---------------------------------------------------
+    //***-------------------TEST 15-------------------***//
+    //---------------------------------------------------
+    //counted infections should go through the same states as an individual disease, step by step
+    if (rank==0)cout<<"Test15: counted infections follow individual disease progression"<<endl;
+    {
+     _compartments.clear();
+     disease d;
+     d.infect();
+     _compartments.infect(x,y,SusceptiblePool::male,3);
+     for (unsigned n=0;n<=_compartments.steps()+2;n++){
+        d.update();
+        _compartments.update(x,y);
+        assert(_compartments.infected(x,y)+_compartments.recovered(x,y)==3);
+        assert((_compartments.recovered(x,y)==3)==d.recovered());
+        assert((_compartments.infectious(x,y)==3)==(d.infectious() && !d.recovered()));
+     }
+     _compartments.clear();
+    }
+    if (rank==0)cout<<"Test15 succeeded"<<endl;
+
+    //---------------------------------------------------
+    //***-------------------TEST 16-------------------***//
+    //---------------------------------------------------
+    //humans that are deleted should hand their storage back to the slab pool, to be reused by the next ones made
+    if (rank==0)cout<<"Test16: slab pool reuses storage of deleted humans"<<endl;
+    {
+     size_t inUse=Human::_Pool.inUse();
+     std::vector<Human*> humans;
+     for (unsigned i=0;i<100;i++){
+        repast::AgentId id(Human::_NextID, rank, _humanType);
+        humans.push_back(new Human(id));
+     }
+     assert(Human::_Pool.inUse()==inUse+100);
+     size_t capacity=Human::_Pool.capacity();
+     std::set<Human*> freed(humans.begin(),humans.end());
+     for (auto h:humans)delete h;
+     assert(Human::_Pool.inUse()==inUse);
+     for (unsigned i=0;i<100;i++){
+        repast::AgentId id(Human::_NextID, rank, _humanType);
+        Human* h=new Human(id);
+        assert(freed.count(h)==1);
+        humans[i]=h;
+     }
+     assert(Human::_Pool.capacity()==capacity);
+     for (auto h:humans)delete h;
+    }
+    if (rank==0)cout<<"Test16 succeeded"<<endl;
+
+    //---------------------------------------------------
+    //***-------------------TEST 17-------------------***//
+    //---------------------------------------------------
+    //the cell columns should match the agents they mirror, slot for slot, after agents are added, moved and removed,
+    //and the per-cell compartment tallies should match a recount. The infectious cells, and local cells with one in range, kept from the changes
+    //should match a scan of the whole index, both after a recount from scratch and after later changes.
+    //Tests 1-12 add, move and remove agents directly in the context and space, so the index is first rebuilt to match
+    if (rank==0)cout<<"Test17: cell columns and tallies match agents"<<endl;
+    rebuildCellIndex();
+    {
+     std::vector<Human*> humans;
+     for (unsigned i=0;i<20;i++){
+        repast::AgentId id(Human::_NextID, rank, _humanType);
+        id.currentRank(rank);
+        Human* h=new Human(id);
+        h->_location=Coordinates(_xlo+0.5,_ylo+0.5);
+        if (i%3==0)h->infectWith(DiseaseRegistry::covid);
+        addAgent(h,repast::Point<int>(_xlo,_ylo));
+        humans.push_back(h);
+     }
+     for (unsigned i=0;i<humans.size();i+=2){
+        humans[i]->_location=Coordinates(_xhi-0.5,_yhi-0.5);
+        moveAgent(humans[i],{_xhi-1,_yhi-1});
+     }
+     for (unsigned i=1;i<humans.size();i+=4)removeAgent(humans[i]);
+     for (int b:{_cells.index(_xlo,_ylo),_cells.index(_xhi-1,_yhi-1)}){
+        std::vector<MadAgent*>& agents=_cells.bucket(b);
+        const CellColumns& columns=_cells.columns(b);
+        assert(columns._x.size()==agents.size() && columns.size()==agents.size());
+        unsigned counts[CellColumns::numberOfCompartments+1]={0,0,0,0,0};
+        for (unsigned k=0;k<agents.size();k++){
+            assert(columns._x[k]==agents[k]->_location[0] && columns._y[k]==agents[k]->_location[1]);
+            assert(columns.state(k)==columnState(agents[k]));
+            counts[CellColumns::compartmentOf(columns.state(k))]++;
+        }
+        for (unsigned c=0;c<CellColumns::numberOfCompartments;c++)assert(_cells.tally(b,c)==counts[c] && columns.recount(c)==counts[c]);
+     }
+     auto checkInfectious=[&](int range){
+        _cells.updateInfectious(range);
+        std::set<int> infectious(_cells.infectiousBuckets().begin(),_cells.infectiousBuckets().end());
+        std::set<int> inRange(_cells.inRangeBuckets().begin(),_cells.inRangeBuckets().end());
+        assert(infectious.size()==_cells.infectiousBuckets().size() && inRange.size()==_cells.inRangeBuckets().size());
+        for (int b=0;b<int(_cells.numberOfBuckets());b++){
+            assert(_cells.infectious(b)==_cells.columns(b).count(CellColumns::infectious));
+            assert(infectious.count(b)==(_cells.infectious(b)>0));
+            int x,y;
+            _cells.coordinates(b,x,y);
+            bool active=false;
+            for (int i=-range;i<=range;i++)for (int j=-range;j<=range;j++)active|=(_cells.infectiousAt(x+i,y+j)>0);
+            assert(inRange.count(b)==(_cells.isLocalIndex(b) && active));
+        }
+     };
+     checkInfectious(0);
+     checkInfectious(1);
+     for (unsigned i=0;i<humans.size();i+=3)if (i%4!=1){humans[i]->clearDiseases();_cells.refresh(humans[i],columnState(humans[i]));}
+     checkInfectious(1);
+     for (unsigned i=0;i<humans.size();i++)if (i%4!=1)removeAgent(humans[i]);
+     checkInfectious(1);
+    }
+    if (rank==0)cout<<"Test17 succeeded"<<endl;
+
+    //---------------------------------------------------
+    //***-------------------TEST 18-------------------***//
+    //---------------------------------------------------
+    //a human taking random dispersal steps (Human::TryToDisperse, as called from moveIt) is followed by a double precision copy of its position,
+    //making the same moves - with -DQUANTISED_POSITIONS each step adds at most one quantisation error, so the two should never be further
+    //apart than that, inDistance should agree with the exact distance except within that error of the interaction range, and the position
+    //should come through an AgentPackage unchanged. Directions come from a stream of their own, so the model's random numbers are untouched.
+    if (rank==0)cout<<"Test18: quantised positions follow double precision trajectories"<<endl;
+    {
+     std::string dispersalSelection=_dispersalSelection;
+     _dispersalSelection="direct";
+     std::mt19937_64 stream(rank+1);
+     std::uniform_real_distribution<double> direction(0.,2*acos(-1.));
+     double width=_maxX-_minX+1;
+     repast::AgentId id(Human::_NextID, rank, _humanType);
+     Human* h=new Human(id);
+     Human* other=new Human(repast::AgentId(Human::_NextID, rank, _humanType));
+     //allowed in every cell, so the walk does not depend on the land mask
+     h->_Realm=Constants::eAllRealms;
+     h->_alive=true;
+     h->_location=Coordinates(_minX+0.5,_minY+0.5*(_maxY-_minY+1));
+     double exact[2]={h->_location[0],h->_location[1]},otherExact[2];
+     double worst=0;
+     unsigned steps=10000;
+     for (unsigned n=1;n<=steps;n++){
+        //the other human is put back where the walker is every so often, so inDistance is tried at a spread of distances
+        if (n%100==1){other->_location=h->_location;otherExact[0]=exact[0];otherExact[1]=exact[1];}
+        double angle=direction(stream);
+        double u=0.7*E->Width()*cos(angle),v=0.7*E->Height()*sin(angle);
+        Coordinates before=h->_location;
+        h->_destination=h->_location;
+        h->TryToDisperse(u,v,E,this);
+        h->_location=h->_destination;
+        //refused moves (off the top or bottom of the grid) leave both where they are
+        if (h->_location[0]!=before[0] || h->_location[1]!=before[1]){
+            exact[0]+=u/E->Width();
+            exact[1]+=v/E->Height();
+            if (!_noLongitudeWrap && exact[0]<_minX)   exact[0]+=width;
+            if (!_noLongitudeWrap && exact[0]>=_maxX+1)exact[0]-=width;
+        }
+        double dx=fabs(exact[0]-h->_location[0]);
+        if (!_noLongitudeWrap)dx=std::min(dx,width-dx);
+        worst=std::max(worst,std::max(dx,fabs(exact[1]-h->_location[1])));
+        assert(worst<n/65536.);
+        double separation=fabs(exact[0]-otherExact[0]);
+        if (!_noLongitudeWrap)separation=std::min(separation,width-separation);
+        separation=std::max(separation,fabs(exact[1]-otherExact[1]));
+        if (fabs(separation-1.)>2*n/65536.)assert(h->inDistance(h,other,this)==(separation<1.));
+        if (n%100==0){
+            AgentPackage package(h->getId());
+            h->PushThingsIntoPackage(package);
+            Human copy(h->getId(),package);
+            for (unsigned i=0;i<2;i++)assert(copy._location[i]==h->_location[i] && copy._destination[i]==h->_destination[i]);
+        }
+     }
+     if (rank==0)cout<<"Test18: largest difference after "<<steps<<" steps "<<worst<<" cells"<<endl;
+     delete h;
+     delete other;
+     _dispersalSelection=dispersalSelection;
+    }
+    if (rank==0)cout<<"Test18 succeeded"<<endl;
+
+    //---------------------------------------------------
+    //***-------------------TEST 19-------------------***//
+    //---------------------------------------------------
+    //with neighbour-only migration, moves to the next rank should go through without falling back to POLL,
+    //and a move beyond the neighbouring ranks (if there is one) should make every rank fall back - either way no agents are lost
+    if (rank==0)cout<<"Test19: neighbour-only migration with fallback for long jumps"<<endl;
+    {
+     _neighbourMigration=true;
+     std::vector<MadAgent*> agents;
+     _context.selectAgents(repast::SharedContext<MadAgent>::LOCAL,agents);
+     int before=agents.size(),totalBefore=0;
+     MPI_Allreduce(&before, &totalBefore, 1, MPI::INT, MPI::SUM,MPI_COMM_WORLD);
+     n=20;
+     //the test humans are those with ids from first[r] to first[r]+n-1 starting on each rank r
+     std::vector<int> first(nranks);
+     int myFirst=Human::_NextID;
+     MPI_Allgather(&myFirst, 1, MPI::INT, first.data(), 1, MPI::INT, MPI_COMM_WORLD);
+     int width=_maxX-_minX+1;
+     std::vector<Human*> humans;
+     for (int i=0;i<n;i++){
+        repast::AgentId id(Human::_NextID, rank, _humanType);
+        id.currentRank(rank);
+        Human* h=new Human(id);
+        h->setup(0,1, E,random);
+        h->setLocation(_xhi-0.5,_ylo+0.5);
+        addAgent(h,repast::Point<int>(_xhi-1,_ylo));
+        humans.push_back(h);
+     }
+     //one cell across the upper x edge - always a neighbouring rank (or this one)
+     int next=(_xhi-_minX)%width+_minX;
+     for (int i=0;i<n;i+=2){
+        humans[i]->setLocation(next+0.5,_ylo+0.5);
+        moveAgent(humans[i],{next,_ylo});
+     }
+     unsigned fallbacks=_pollFallbacks;
+     sync();
+     assert(_pollFallbacks==fallbacks);
+     agents.clear();
+     _context.selectAgents(repast::SharedContext<MadAgent>::LOCAL,agents);
+     int after=agents.size(),totalAfter=0;
+     MPI_Allreduce(&after, &totalAfter, 1, MPI::INT, MPI::SUM,MPI_COMM_WORLD);
+     assert(totalAfter==totalBefore+n*nranks);
+     //two ranks further on in x, if that is not a neighbour (needs at least 4 ranks in x)
+     int far=(_xlo+2*(_xhi-_xlo)-_minX)%width+_minX;
+     bool longJump=!_ranks.isNeighbour(far,_ylo);
+     if (longJump && rank==0){
+        humans[1]->setLocation(far+0.5,_ylo+0.5);
+        moveAgent(humans[1],{far,_ylo});
+     }
+     sync();
+     assert(_pollFallbacks==fallbacks+(longJump ? 1 : 0));
+     agents.clear();
+     _context.selectAgents(repast::SharedContext<MadAgent>::LOCAL,agents);
+     after=agents.size();
+     MPI_Allreduce(&after, &totalAfter, 1, MPI::INT, MPI::SUM,MPI_COMM_WORLD);
+     assert(totalAfter==totalBefore+n*nranks);
+     //test humans may now be on any rank, so tidy up by id
+     for (auto a:agents){
+        const repast::AgentId& id=a->getId();
+        if (id.agentType()==_humanType && id.id()>=first[id.startingRank()] && id.id()<first[id.startingRank()]+n)removeAgent(a);
+     }
+     sync();
+     _pollFallbacks=fallbacks;
+    }
+    _neighbourMigration=neighbourMigration;
+    if (rank==0)cout<<"Test19 succeeded"<<endl;
+
+    //---------------------------------------------------
+    //***-------------------TEST 20-------------------***//
+    //---------------------------------------------------
+    //the non-blocking buffer zone update used with simulation.OverlapHalo should bring copies up to date as synchronizeStates does:
+    //humans in every boundary cell are infected after their copies are made, so copies with even ids should then have covid
+    if (repast::strToInt(_props->getProperty("grid.buffer"))==1){
+     if (rank==0)cout<<"Test20: non-blocking buffer zone update"<<endl;
+     //as in Test19 - the test humans started on rank r have ids from first[r] to last[r]-1
+     std::vector<int> first(nranks),last(nranks);
+     int myFirst=Human::_NextID,myLast=myFirst+_halo.boundaryCells().size();
+     MPI_Allgather(&myFirst, 1, MPI::INT, first.data(), 1, MPI::INT, MPI_COMM_WORLD);
+     MPI_Allgather(&myLast,  1, MPI::INT, last.data(),  1, MPI::INT, MPI_COMM_WORLD);
+     std::vector<Human*> humans;
+     for (auto& [x,y]:_halo.boundaryCells()){
+        repast::AgentId id(Human::_NextID, rank, _humanType);
+        id.currentRank(rank);
+        Human* h=new Human(id);
+        h->setup(0,1, E,random);
+        h->setLocation(x+0.5,y+0.5);
+        addAgent(h,repast::Point<int>(x,y));
+        humans.push_back(h);
+     }
+     sync();
+     for (auto h:humans)if (h->getId().id()%2==0)h->infectWith(DiseaseRegistry::covid);
+     _halo.start(_cells,startStateSync());
+     for (auto& p:_halo.finish())if (_context.contains(p.getId()))receiver->updateAgent(p);
+     finishStateSync();
+     std::vector<MadAgent*> copies;
+     _context.selectAgents(repast::SharedContext<MadAgent>::NON_LOCAL,copies);
+     for (auto a:copies){
+        const repast::AgentId& id=a->getId();
+        if (id.agentType()==_humanType && id.id()>=first[id.startingRank()] && id.id()<last[id.startingRank()] && id.id()%2==0)assert(((Human*)a)->hasDisease(DiseaseRegistry::covid));
+     }
+     for (auto h:humans)removeAgent(h);
+     sync();
+     if (rank==0)cout<<"Test20 succeeded"<<endl;
+    }
+
+    //---------------------------------------------------
+    //***-------------------TEST 21-------------------***//
+    //---------------------------------------------------
+    //with an infectious human in every boundary cell of every rank, the compact records used with simulation.InfectiousHalo should
+    //put a stand-in for it in the matching halo cell of each neighbour - at the same position and infectious with the same diseases,
+    //and never local (so never infected themselves). Positions within the cell and the diseases vary with the global cell, so each
+    //rank can work out what its neighbours should have sent. Without the infectious halo the buffer zone holds real copies instead.
+    if (_infectiousHalo){
+     if (rank==0)cout<<"Test21: stand-ins for infectious humans on other ranks"<<endl;
+     unsigned flu=DiseaseRegistry::id("flu");
+     auto expectedLocation=[](int x,int y){return Coordinates(x+0.125*(1+((x+2*y)%7+7)%7),y+0.125*(1+((2*x+y)%7+7)%7));};
+     auto expectedDiseases=[flu](int x,int y){return uint8_t((1<<DiseaseRegistry::covid)|(((x+y)%2==0) ? 1<<flu : 0));};
+     std::vector<Human*> humans;
+     for (auto& [x,y]:_halo.boundaryCells()){
+        repast::AgentId id(Human::_NextID, rank, _humanType);
+        id.currentRank(rank);
+        Human* h=new Human(id);
+        h->setup(0,1, E,random);
+        Coordinates location=expectedLocation(x,y);
+        h->setLocation(location[0],location[1]);
+        h->infectWith(DiseaseRegistry::covid);
+        h->diseaseState(DiseaseRegistry::covid).becomeInfectious();
+        if ((expectedDiseases(x,y)>>flu)&1){h->infectWith(flu);h->diseaseState(flu).becomeInfectious();}
+        addAgent(h,repast::Point<int>(x,y));
+        humans.push_back(h);
+     }
+     updateStandIns();
+     int width=_maxX-_minX+1,height=_maxY-_minY+1;
+     for (int x=_xlo-1;x<=_xhi;x++){
+        for (int y=_ylo-1;y<=_yhi;y++){
+            int b=_cells.index(x,y);
+            if (b<0 || _cells.isLocalIndex(b)) continue;
+            int gx=_minX+((x-_minX)%width+width)%width,gy=_minY+((y-_minY)%height+height)%height;
+            std::vector<MadAgent*>& agents=_cells.bucket(b);
+            assert(_cells.infectious(b)==agents.size());
+            bool found=false;
+            for (unsigned k=0;k<agents.size();k++){
+                assert(agents[k]->getId().startingRank()==-1 && !_cells.columns(b).has(k,CellColumns::localHuman));
+                Coordinates location=expectedLocation(gx,gy);
+                if (fabs(agents[k]->_location[0]-location[0])<1.e-6 && fabs(agents[k]->_location[1]-location[1])<1.e-6){
+                    assert(((Human*)agents[k])->infectiousDiseases()==expectedDiseases(gx,gy));
+                    found=true;
+                }
+            }
+            assert(found);
+        }
+     }
+     for (auto h:humans)removeAgent(h);
+     sync();
+     if (rank==0)cout<<"Test21 succeeded"<<endl;
+    }else if (rank==0)cout<<"Test21 skipped - needs simulation.CrossCellInteraction and simulation.InfectiousHalo"<<endl;
+
     //---------------------------------------------------
     //***-------------------Finished TESTS-------------------***//
     //---------------------------------------------------
@@ -1317,8 +2377,8 @@ void MadModel::tests(){
 //see Cohort::setup
 void MadModel::setupHumanTestValues(Human* c){
 
-    c->_diseases["covid"].infect();
-    c->_diseases["flu"];
+    c->diseaseState("covid").infect();
+    c->diseaseState("flu");
 /*
     c->_Merged                      = false;
     c->_alive                       = true;
@@ -1332,9 +2392,9 @@ void MadModel::setupHumanTestValues(Human* c){
 //check that the values set in the above function are still maintained
 void MadModel::checkHumanTestValues(Human* c){
 
-    assert(c->_diseases["covid"].infected());
-    assert(!c->_diseases["flu"].infected());
-    assert(c->_Realm      =="terrestrial");
+    assert(c->diseaseState("covid").infected());
+    assert(c->hasDisease("flu") && !c->diseaseState("flu").infected());
+    assert(c->_Realm      ==Constants::eTerrestrial);
 /*
 
     assert(c->_alive                       == true);
@@ -1349,3 +2409,227 @@ void MadModel::checkHumanTestValues(Human* c){
 //---------------------------------------------------------------------------------------------------------------------------
 //***------------------------------------------------END TESTING Section----------------------------------------------------***//
 //---------------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------------
+//***------------------------------------------------BENCHMARK Section----------------------------------------------------***//
+//---------------------------------------------------------------------------------------------------------------------------
+//an AgentPackage sent member by member through Boost.Serialization, as packages were before they became plain data - for Benchmark3
+struct FieldwisePackage {
+    AgentPackage _package;
+    template<class Archive>
+    void serialize(Archive& ar, const unsigned int version) {
+        for (auto& i:_package._id)ar & i;
+        content& c=_package._contents;
+        ar & c._fields;
+        ar & c._sequencer;
+        ar & c._FunctionalGroupIndex;
+        ar & c._IndividualBodyMass;
+        ar & c._BirthTimeStep;
+        ar & c._MaturityTimeStep;
+        ar & c._alive;
+        ar & c._IsMature;
+        ar & c._moved;
+        ar & c._sex;
+        for (auto& d:c._diseases)ar & d;
+        ar & c._location;
+        ar & c._destination;
+    }
+};
+//---------------------------------------------------------------------------------------------------------------------------
+//run with run.benchmarks=true in model.props - the model is initialised as normal and then timings of alternative
+//code paths are printed on rank 0 (maximum over threads) and saved in RunParameters
+void MadModel::benchmarks(){
+    int rank = repast::RepastProcess::instance()->rank();
+    int repeats=10;
+    std::string r=_props->getProperty("benchmark.repeats");
+    if (r!="")repeats=repast::strToInt(r);
+    int range=0;
+    if (_crossCell) range=1;
+    //---------------------------------------------------
+    //***-------------BENCHMARK 1: cell gathering-------------***//
+    //---------------------------------------------------
+    //the agents visited per step by the interaction, birth/death and dispersal passes - found with repast grid queries
+    //(as MadModel::step used to) versus the per-cell lists in _cells
+    if (rank==0)cout<<"Benchmark1: gather agents per cell for the three passes in step(), "<<repeats<<" repeats"<<endl;
+    long countQuery=0,countIndex=0;
+    repast::Timer queryTimer;
+    queryTimer.start();
+    for (int n=0;n<repeats;n++){
+        for(int x = _xlo - range; x < _xhi + range; x++){
+            for(int y = _ylo - range; y < _yhi + range; y++){
+                if (x>= _minX && x<=_maxX && y>= _minY && y<=_maxY){
+                    repast::Point<int> location(x,y);
+                    std::vector<MadAgent*> agents,thingsToInteract;
+                    repast::VN2DGridQuery<MadAgent> VN2DQuery(space());
+                    VN2DQuery.query(location, 0, true, agents);
+                    repast::Moore2DGridQuery<MadAgent> Moore2DQuery(space());
+                    Moore2DQuery.query(location, range, true, thingsToInteract);
+                    countQuery+=agents.size()+thingsToInteract.size();
+                }
+            }
+        }
+        for (int pass=0;pass<2;pass++){
+            for(int x = _xlo; x < _xhi; x++){
+                for(int y = _ylo; y < _yhi; y++){
+                    repast::Point<int> location(x,y);
+                    std::vector<MadAgent*> agentsInCell;
+                    repast::VN2DGridQuery<MadAgent> VN2DQuery(space());
+                    VN2DQuery.query(location, 0, true, agentsInCell);
+                    countQuery+=agentsInCell.size();
+                }
+            }
+        }
+    }
+    double tQuery=queryTimer.stop();
+
+    repast::Timer indexTimer;
+    indexTimer.start();
+    for (int n=0;n<repeats;n++){
+        for(int x = _xlo - range; x < _xhi + range; x++){
+            for(int y = _ylo - range; y < _yhi + range; y++){
+                if (x>= _minX && x<=_maxX && y>= _minY && y<=_maxY){
+                    std::vector<MadAgent*>* agents=_cells.cell(x,y);
+                    if (agents!=NULL)countIndex+=agents->size();
+                    for (int i=-range;i<=range;i++)for (int j=-range;j<=range;j++){
+                        std::vector<MadAgent*>* thingsToInteract=_cells.cell(x+i,y+j);
+                        if (thingsToInteract!=NULL)countIndex+=thingsToInteract->size();
+                    }
+                }
+            }
+        }
+        for (int pass=0;pass<2;pass++){
+            for(int x = _xlo; x < _xhi; x++){
+                for(int y = _ylo; y < _yhi; y++){
+                    countIndex+=_cells.cell(x,y)->size();
+                }
+            }
+        }
+    }
+    double tIndex=indexTimer.stop();
+    //both paths should see the same agents
+    if (countQuery!=countIndex)cout<<"Benchmark1: warning - rank "<<rank<<" grid queries found "<<countQuery<<" agents, cell index "<<countIndex<<endl;
+    double maxQuery,maxIndex;
+    MPI_Reduce(&tQuery, &maxQuery, 1, MPI::DOUBLE, MPI::MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&tIndex, &maxIndex, 1, MPI::DOUBLE, MPI::MAX, 0, MPI_COMM_WORLD);
+    if (rank==0){
+        cout<<"Benchmark1: grid queries "<<maxQuery<<"s cell index "<<maxIndex<<"s"<<endl;
+        _props->putProperty("benchmark.cellquery.time", maxQuery);
+        _props->putProperty("benchmark.cellindex.time", maxIndex);
+    }
+    //---------------------------------------------------
+    //***-------------BENCHMARK 2: distance kernel-------------***//
+    //---------------------------------------------------
+    //one infector against a batch of candidates spread over its neighbourhood: per pair Human::inDistance calls versus
+    //the scalar and vector versions of the batched kernel
+    {
+    unsigned n=100000;
+    std::string c=_props->getProperty("benchmark.candidates");
+    if (c!="")n=repast::strToInt(c);
+    if (rank==0)cout<<"Benchmark2: distance test for "<<n<<" candidates, "<<repeats<<" repeats, kernel uses "<<DistanceKernel::instructionSet()<<endl;
+    RandomRepast random;
+    int x=_xlo,y=_ylo;
+    std::vector<Human*> humans;
+    Candidates candidates;
+    for (unsigned i=0;i<n;i++){
+        repast::AgentId id(Human::_NextID, rank, _humanType);
+        Human* h=new Human(id);
+        h->setLocation(x-1+3*random.GetUniform(),y-1+3*random.GetUniform());
+        humans.push_back(h);
+        candidates.push_back(h);
+    }
+    Human* infector=humans[0];
+    double width=_maxX-_minX+1;
+    std::vector<unsigned> index(n);
+    long countPair=0,countScalar=0,countKernel=0;
+
+    repast::Timer pairTimer;
+    pairTimer.start();
+    for (int r=0;r<repeats;r++)for (auto h:humans)if (infector->inDistance(infector,h,this))countPair++;
+    double tPair=pairTimer.stop();
+
+    repast::Timer scalarTimer;
+    scalarTimer.start();
+    for (int r=0;r<repeats;r++)countScalar+=DistanceKernel::inRangeScalar(infector->_location[0],infector->_location[1],candidates._x.data(),candidates._y.data(),n,width,!_noLongitudeWrap,index.data());
+    double tScalar=scalarTimer.stop();
+
+    repast::Timer kernelTimer;
+    kernelTimer.start();
+    for (int r=0;r<repeats;r++)countKernel+=DistanceKernel::inRange(infector->_location[0],infector->_location[1],candidates._x.data(),candidates._y.data(),n,width,!_noLongitudeWrap,index.data());
+    double tKernel=kernelTimer.stop();
+
+    if (countPair!=countScalar || countPair!=countKernel)cout<<"Benchmark2: warning - rank "<<rank<<" in range per pair "<<countPair<<" scalar kernel "<<countScalar<<" vector kernel "<<countKernel<<endl;
+    for (auto h:humans)delete h;
+    double maxPair,maxScalar,maxKernel;
+    MPI_Reduce(&tPair,   &maxPair,   1, MPI::DOUBLE, MPI::MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&tScalar, &maxScalar, 1, MPI::DOUBLE, MPI::MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&tKernel, &maxKernel, 1, MPI::DOUBLE, MPI::MAX, 0, MPI_COMM_WORLD);
+    if (rank==0){
+        cout<<"Benchmark2: per pair "<<maxPair<<"s scalar kernel "<<maxScalar<<"s "<<DistanceKernel::instructionSet()<<" kernel "<<maxKernel<<"s"<<endl;
+        _props->putProperty("benchmark.distance.pair.time", maxPair);
+        _props->putProperty("benchmark.distance.scalar.time", maxScalar);
+        _props->putProperty("benchmark.distance.kernel.time", maxKernel);
+    }
+    }
+    //---------------------------------------------------
+    //***-------------BENCHMARK 3: agent packages-------------***//
+    //---------------------------------------------------
+    //packing and unpacking a batch of packages as repast does for migration and ghost updates: member by member
+    //versus the flat package, which Boost.MPI copies as an MPI derived datatype
+    {
+    unsigned n=100000;
+    std::string c=_props->getProperty("benchmark.packages");
+    if (c!="")n=repast::strToInt(c);
+    if (rank==0)cout<<"Benchmark3: pack and unpack "<<n<<" agent packages, "<<repeats<<" repeats"<<endl;
+    repast::AgentId id(Human::_NextID, rank, _humanType);
+    Human* h=new Human(id);
+    h->setLocation(_xlo+0.5,_ylo+0.5);
+    std::vector<AgentPackage> flat(n);
+    std::vector<FieldwisePackage> fieldwise(n);
+    for (unsigned i=0;i<n;i++){
+        flat[i].setId(repast::AgentId(i, rank, _humanType));
+        h->PushThingsIntoPackage(flat[i]);
+        fieldwise[i]._package=flat[i];
+    }
+    delete h;
+    boost::mpi::communicator world;
+    std::vector<AgentPackage> flatOut;
+    std::vector<FieldwisePackage> fieldwiseOut;
+
+    repast::Timer fieldwiseTimer;
+    fieldwiseTimer.start();
+    for (int r=0;r<repeats;r++){
+        boost::mpi::packed_oarchive::buffer_type buffer;
+        boost::mpi::packed_oarchive out(world,buffer);
+        out<<fieldwise;
+        boost::mpi::packed_iarchive in(world,buffer);
+        in>>fieldwiseOut;
+    }
+    double tFieldwise=fieldwiseTimer.stop();
+
+    repast::Timer flatTimer;
+    flatTimer.start();
+    for (int r=0;r<repeats;r++){
+        boost::mpi::packed_oarchive::buffer_type buffer;
+        boost::mpi::packed_oarchive out(world,buffer);
+        out<<flat;
+        boost::mpi::packed_iarchive in(world,buffer);
+        in>>flatOut;
+    }
+    double tFlat=flatTimer.stop();
+
+    if (flatOut.size()!=n || fieldwiseOut.size()!=n || !(flatOut[n-1].getId()==flat[n-1].getId()) || !(fieldwiseOut[n-1]._package.getId()==flat[n-1].getId()))
+        cout<<"Benchmark3: warning - rank "<<rank<<" packages did not survive the round trip"<<endl;
+    double maxFieldwise,maxFlat;
+    MPI_Reduce(&tFieldwise, &maxFieldwise, 1, MPI::DOUBLE, MPI::MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&tFlat,      &maxFlat,      1, MPI::DOUBLE, MPI::MAX, 0, MPI_COMM_WORLD);
+    if (rank==0){
+        double fieldwiseRate=maxFieldwise>0 ? double(n)*repeats/maxFieldwise : 0;
+        double flatRate     =maxFlat>0      ? double(n)*repeats/maxFlat      : 0;
+        cout<<"Benchmark3: member by member "<<fieldwiseRate<<" packages/s flat "<<flatRate<<" packages/s"<<endl;
+        _props->putProperty("benchmark.packages.fieldwise.rate", fieldwiseRate);
+        _props->putProperty("benchmark.packages.flat.rate", flatRate);
+    }
+    }
+    //---------------------------------------------------
+    //***-------------------Finished BENCHMARKS-------------------***//
+    //---------------------------------------------------
+}
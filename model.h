@@ -17,6 +17,14 @@
 #include "EnvironmentCell.h"
 #include "Human.h"
 #include "agent.h"
+#include "CellIndex.h"
+#include "RealmMask.h"
+#include "RankNeighbours.h"
+#include "HaloExchange.h"
+#include "ForceOfInfection.h"
+#include "CellScheduler.h"
+#include "SusceptiblePool.h"
+#include "CompartmentCells.h"
 
 
 class MadModel;
@@ -32,10 +40,13 @@ class MadAgentPackageProvider {
 	
 private:
     repast::SharedContext<MadAgent>* agents;
+    //if false, ghost updates (provideContent) only carry the fields each human has changed since the last update
+    bool _fullRefresh;
 	
 public:
 	
    MadAgentPackageProvider(repast::SharedContext<MadAgent>* agentPtr);
+    void fullRefresh(bool f){_fullRefresh=f;}
 
     void providePackage(MadAgent * agent, std::vector<AgentPackage>& out);
 
@@ -47,14 +58,22 @@ class MadAgentPackageReceiver {
 	
 private:
     repast::SharedContext<MadAgent>* agents;
+    //ids of agents that arrived on this rank during a sync - the model adds these afterwards to its CellIndex
+    std::vector<repast::AgentId> _received;
+    //only agent status syncs move agents between ranks - ghost creation and state updates are not recorded
+    bool _recordArrivals;
 	
 public:
 	
     MadAgentPackageReceiver(repast::SharedContext<MadAgent>* agentPtr);
 	
-    MadAgent * createAgent(AgentPackage package);
+    //packages are unpacked straight from repast's receive buffer - no copy
+    MadAgent * createAgent(const AgentPackage& package);
 	
-    void updateAgent(AgentPackage package);
+    void updateAgent(const AgentPackage& package);
+
+    std::vector<repast::AgentId>& received(){return _received;}
+    void recordArrivals(bool r){_recordArrivals=r;}
 	
 };
 //------------------------------------------------------------------------------------------
@@ -75,6 +94,26 @@ class MadModel{
 	MadAgentPackageReceiver* receiver;
 
     wrappedSpaceType* discreteSpace;
+    //agents on this rank (plus any buffer zone copies) bucketed by cell
+    CellIndex _cells;
+    //per-cell infection pressure - used instead of pairwise interaction if simulation.InteractionMode=forceOfInfection
+    bool _forceOfInfection;
+    std::vector<ForceOfInfection> _foi;
+    //infection sources in each bucket of _cells, taken before the force of infection pass (see takeSources)
+    std::vector< std::vector<InfectionSource> > _sources;
+    std::vector<int> _sourceBuckets;
+    void takeSources();
+    //number of threads used for the cell loops in step() (simulation.Threads) 
+    unsigned _threads;
+    //shares the cell passes in step() between threads
+    CellScheduler _scheduler;
+    //susceptibles held as per-cell counts until infected (simulation.LazySusceptibles=true)
+    bool _lazySusceptibles;
+    SusceptiblePool _pool;
+    //cells switch between counts and individuals (simulation.HybridCells=true)
+    bool _hybridCells;
+    unsigned _promoteBelow,_demoteAbove;
+    CompartmentCells _compartments;
     int _totalSusceptible;
     int _totalInfected;
     int _totalRecovered;
@@ -95,11 +134,54 @@ class MadModel{
     
     std::string _filePrefix, _filePostfix;
     void dataSetClose();
+    void reportThreadLoad();
+    void memoryReport();
     void addDataSet(repast::DataSet*) ;
     void setupNcOutput();
     void netcdfOutput( unsigned step );
     void setNcGridFile(std::string,std::string );
     void writeNcGridFile(unsigned,vector<double>&,std::string);
+    //wrappers round the context and space that keep _cells up to date
+    void addAgent(MadAgent*,const repast::Point<int>&);
+    void removeAgent(MadAgent*);
+    void moveAgent(MadAgent*,const std::vector<int>&);
+    void updateCellIndex();
+    //index every local agent afresh from the repast space - for after agents have been handled without the wrappers
+    void rebuildCellIndex();
+    //synchronizeAgentStates, sending only changed humans and fields except every _ghostRefreshInterval calls
+    void synchronizeStates();
+    bool startStateSync();
+    void finishStateSync();
+    unsigned _ghostRefreshInterval,_stateSyncs;
+    //local cells in the order the cell passes visit them, and split into those in other ranks' buffer zones and the rest
+    std::vector< std::pair<int,int> > _localCells;
+    bool _overlapHalo;
+    HaloExchange _halo;
+    //infectious humans on other ranks are sent as InfectiousRecords, and stand in for buffer zone copies (simulation.InfectiousHalo=true)
+    bool _infectiousHalo;
+    std::vector<Human*> _standIns;
+    void updateStandIns();
+    //agents leaving this rank only go to neighbouring ranks (simulation.Migration=neighbours) unless _longJump is set on any rank,
+    //in which case sync() falls back to POLL - _pollFallbacks counts how often
+    bool _neighbourMigration,_longJump;
+    unsigned _pollFallbacks;
+    RankNeighbours _ranks;
+    void checkMigration(int x,int y);
+    //CellColumns flags for an agent, as held in _cells
+    uint8_t columnState(MadAgent*);
+    //cells the interaction pass needs to visit this timestep
+    std::vector< std::vector< std::pair<int,int> > > _activeCells;
+    void findActiveCells(int);
+    int colourOf(int,int,int);
+    //withinCell keeps the human inside cell x,y (placed uniformly over it) rather than jittered about the cell corner
+    Human* createHuman(int x,int y,randomizer*,bool withinCell=false);
+    void infectPool(int range);
+    void writePoolRestart(unsigned step);
+    void readPoolRestart(unsigned step);
+    void rebalanceCells(const std::vector< std::pair<int,int> >&);
+    void scaleTotals();
+    void writeCompartmentRestart(unsigned step);
+    void readCompartmentRestart(unsigned step);
     std::vector<AgentPackage>_packages;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version)
@@ -120,7 +202,11 @@ public:
     int _xlo,_xhi,_ylo,_yhi;
     int _noLongitudeWrap; //1 if domain does *not* span the global longitude range
     string _dispersalSelection;
+    //number of people each human (or pooled count) stands for (simulation.AgentWeight)
+    double _agentWeight;
     Environment _Env;
+    //land cells near this rank - used for the realm check in dispersal
+    RealmMask _land;
     
 	MadModel(repast::Properties& ,  boost::mpi::communicator* comm);
 	~MadModel();
@@ -138,6 +224,7 @@ public:
     void write_restart();
     void setupOutputs();
     void tests();
+    void benchmarks();
     void setupHumanTestValues(Human*);
     void checkHumanTestValues(Human*);
     int PopCount() const {